@@ -1,17 +1,57 @@
 #ifndef BST_HPP_
 #define BST_HPP_
 
+#include <cmath>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "./adapt.hpp"
+#include "./augment.hpp"
+#include "./compare.hpp"
+#include "./lookup.hpp"
+#include "./merkle.hpp"
+#include "./parallel.hpp"
+#include "./setops.hpp"
+#include "./stats.hpp"
+#include "./trace.hpp"
+
 // Implementação simplória de uma Binary Search Tree feita para
 // a disciplina de Estruturas de Dados, agora tenho como reaproveitar
 
-template<class K, class V>
+/**
+ * @tparam Compare Comparador de três vias das chaves (ver compare.hpp). Com
+ * cmp::PrefixThreeWay, cada nó guarda um prefixo da chave.
+ * @tparam Access Política de acesso (ver adapt.hpp). Com adapt::SemiSplay ou
+ * adapt::Frequency, find e search aproximam as chaves buscadas da raiz.
+ * @tparam Digest Hash de subárvore (ver merkle.hpp). Com merkle::Content,
+ * cada nó guarda o hash do conteúdo da sua subárvore, o que permite
+ * same_content em O(1) e diff proporcional às mudanças.
+ * @tparam Augment Agregado de subárvore (ver augment.hpp). Com uma política
+ * como augment::Sum, cada nó guarda a soma dos valores da sua subárvore, e
+ * aggregate(lo, hi) combina um intervalo de chaves em O(altura).
+ */
+template<class K, class V, class Compare = cmp::ThreeWay, class Access = adapt::None,
+         class Digest = merkle::None, class Augment = augment::None>
 class BST {
  public:
-    struct Node {
+    using key_type = K;
+    using mapped_type = V;
+    using key_compare = Compare;
+    using access_policy = Access;
+    using digest_policy = Digest;
+    using augment_policy = Augment;
+
+    static constexpr bool has_prefix = cmp::has_prefix<Compare>::value;
+    static constexpr bool has_hash = Digest::enabled;
+    static constexpr bool has_aggregate = augment::stored<Augment>;
+
+    struct Node : cmp::PrefixField<has_prefix>, adapt::HitsField<Access::counts>,
+                  merkle::HashField<Digest>, augment::AggregateField<Augment> {
         Node* m_left;
         Node* m_right;
         Node* m_parent;
@@ -23,9 +63,18 @@ class BST {
             this->m_left = nullptr;
             this->m_right = nullptr;
             this->m_parent = nullptr;
-            this->m_value = value;
-            this->m_key = key;
+            this->m_value = std::move(value);
+            this->m_key = std::move(key);
             this->size = 1;
+            if constexpr (has_prefix) {
+                this->m_prefix = Compare::prefix(this->m_key);
+            }
+            if constexpr (has_hash) {
+                this->m_hash = Digest::entry(this->m_key, this->m_value);
+            }
+            if constexpr (has_aggregate) {
+                this->m_aggregate = Augment::of(this->m_key, this->m_value);
+            }
         }
 
         // Visualização:
@@ -50,43 +99,624 @@ class BST {
         }
     };
 
-    BST() {
+    /**
+     * Percorre os nós em ordem crescente de chave, subindo por m_parent.
+     * O iterador só avança; end() é representado por nullptr.
+     */
+    template<class NodeType>
+    class basic_iterator {
+     public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Node;
+        using difference_type = std::ptrdiff_t;
+        using pointer = NodeType*;
+        using reference = NodeType&;
+
+        basic_iterator(NodeType* node = nullptr) : node(node) {}
+
+        // Permite converter iterator em const_iterator
+        operator basic_iterator<const Node>() const {
+            return basic_iterator<const Node>(this->node);
+        }
+
+        NodeType& operator*() const {
+            return *this->node;
+        }
+
+        NodeType* operator->() const {
+            return this->node;
+        }
+
+        NodeType* get() const {
+            return this->node;
+        }
+
+        basic_iterator& operator++() {
+            if (this->node->m_right) {
+                this->node = this->node->m_right;
+                while (this->node->m_left) {
+                    this->node = this->node->m_left;
+                }
+            } else {
+                NodeType* child = this->node;
+                this->node = this->node->m_parent;
+                while (this->node && this->node->m_right == child) {
+                    child = this->node;
+                    this->node = this->node->m_parent;
+                }
+            }
+            return *this;
+        }
+
+        basic_iterator operator++(int) {
+            basic_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const basic_iterator& other) const {
+            return this->node == other.node;
+        }
+
+        bool operator!=(const basic_iterator& other) const {
+            return this->node != other.node;
+        }
+
+     private:
+        NodeType* node;
+    };
+
+    using iterator = basic_iterator<Node>;
+    using const_iterator = basic_iterator<const Node>;
+
+    explicit BST(Compare compare = Compare()) : compare(compare) {
         this->root = nullptr;
         this->is_list = false;
+        this->tracer = nullptr;
+        this->rebalance_factor = 0;
+    }
+
+    /// Cópia profunda, feita sem recursão.
+    BST(const BST& other) : BST(other.compare) {
+        other.require_tree();
+        this->root = par::clone_serial(other.root, copy_node);
+        if (other.index) {
+            this->enable_index();
+        }
+    }
+
+    BST(BST&& other) noexcept : BST() {
+        this->swap(other);
+    }
+
+    BST& operator=(BST other) noexcept {
+        this->swap(other);
+        return *this;
+    }
+
+    void swap(BST& other) noexcept {
+        std::swap(this->root, other.root);
+        std::swap(this->keys, other.keys);
+        std::swap(this->is_list, other.is_list);
+        std::swap(this->tracer, other.tracer);
+        std::swap(this->rebalance_factor, other.rebalance_factor);
+        std::swap(this->compare, other.compare);
+        std::swap(this->index, other.index);
     }
 
     ~BST() {
+        this->destroy();
+    }
+
+    /// Libera todos os nós, em paralelo se um pool for dado.
+    void clear(par::WorkStealingPool* pool = nullptr) {
+        this->destroy(pool);
+        this->record_bulk();
+    }
+
+    /// Cópia profunda em que as subárvores são copiadas em paralelo.
+    BST clone(par::WorkStealingPool& pool) const {
+        this->require_tree();
+        BST result(this->compare);
+        result.root = par::parallel_clone(pool, this->root, copy_node);
+        if (this->index) {
+            result.enable_index();
+        }
+        return result;
+    }
+
+    /**
+     * Chama function(nó) para cada nó. Sem pool, a ordem é a das chaves; com
+     * pool, os nós são visitados em paralelo e sem ordem definida.
+     */
+    template<class F>
+    void for_each(F&& function, par::WorkStealingPool* pool = nullptr) {
+        this->require_tree();
+        if (pool)
+            par::parallel_for_each(*pool, this->root, function);
+        else
+            par::for_each_serial(this->root, function);
+    }
+
+    /**
+     * Combina map(chave, valor) de todos os nós, na ordem das chaves, usando
+     * uma operação associativa cujo elemento neutro é identity. Com um pool,
+     * as subárvores são reduzidas em paralelo.
+     */
+    template<class T, class Map, class Combine>
+    T reduce(T identity, Map map, Combine combine, par::WorkStealingPool* pool = nullptr) const {
+        this->require_tree();
+        auto map_node = [&map](const Node* node) {
+            return map(node->m_key, node->m_value);
+        };
+        if (pool)
+            return par::parallel_reduce(*pool, this->root, identity, map_node, combine);
+        T result = identity;
+        par::for_each_serial(this->root, [&](const Node* node) {
+            result = combine(result, map_node(node));
+        });
+        return result;
+    }
+
+    Node* get_root() const {
+        return this->root;
+    }
+
+    /// Rejeita operações que percorrem a árvore depois de to_list.
+    void require_tree() const {
         if (this->is_list) {
-            Node* current = this->root;
-            if (current) {
-                Node* next = current->m_right;
-                while (next) {
-                    delete current;
-                    current = next;
-                    next = current->m_right;
-                }
-                delete current;
+            throw std::runtime_error("Operation not supported after to_list.");
+        }
+    }
+
+    /// Altura, profundidades, balanceamento e memória, em uma passada (ver stats.hpp).
+    stats::Summary collect_stats() const {
+        this->require_tree();
+        return stats::collect(this->root);
+    }
+
+    /// Estimativa das mesmas estatísticas a partir de samples nós aleatórios.
+    stats::Summary sample_stats(size_t samples) const {
+        this->require_tree();
+        return stats::sample(this->root, samples);
+    }
+
+    /**
+     * Assume a posse de uma árvore montada externamente, como a carregada de um
+     * snapshot. O campo m_parent dos nós já deve estar correto; size, os
+     * hashes e os agregados de subárvore são recalculados.
+     */
+    void adopt(Node* root) {
+        if (this->root) {
+            throw std::runtime_error("Tree is not empty.");
+        }
+        this->root = root;
+        augment::rebuild(root);
+        this->reindex();
+        this->record_bulk();
+    }
+
+    /**
+     * Mantém um índice auxiliar (ver lookup.hpp) com que find, search e erase
+     * encontram chaves exatas em O(1) e descartam as ausentes pelo filtro de
+     * Bloom, sem descer pela árvore. Custa de 35 a 70 bytes por chave e uma
+     * inserção na tabela a cada inserção na árvore; std::hash<K> precisa ser
+     * compatível com Compare. Buscas por outros tipos de chave e operações
+     * ordenadas continuam usando a árvore.
+     */
+    void enable_index() {
+        this->require_tree();
+        this->index.reset(new lookup::Index<K, Node>());
+        this->reindex();
+    }
+
+    void disable_index() {
+        this->index.reset();
+    }
+
+    /// Memória ocupada pelo índice, ou 0 se ele estiver desligado.
+    size_t index_bytes() const {
+        return this->index ? this->index->bytes() : 0;
+    }
+
+    /**
+     * Hash do conteúdo da árvore (0 se vazia), que não depende do formato.
+     * Valores alterados pelas referências de search ou dos iteradores não
+     * atualizam os hashes; use insert_or_assign para isso.
+     */
+    uint64_t content_hash() const {
+        static_assert(has_hash, "content_hash requires a Digest policy such as merkle::Content.");
+        this->require_tree();
+        return merkle::hash_of(this->root);
+    }
+
+    /// Compara o conteúdo das duas árvores em O(1), pelos hashes das raízes.
+    bool same_content(const BST& other) const {
+        return size_of(this->root) == size_of(other.root) &&
+            this->content_hash() == other.content_hash();
+    }
+
+    /**
+     * Chaves adicionadas, removidas e com valor alterado desta árvore para
+     * other (ver merkle::diff). Diff::marked dá os nós de other a destacar
+     * com Visualization::set_highlight.
+     */
+    merkle::Diff<Node> diff(const BST& other) const {
+        static_assert(has_hash, "diff requires a Digest policy such as merkle::Content.");
+        this->require_tree();
+        other.require_tree();
+        return merkle::diff(this->root, other.root, [this](const Node* a, const Node* b) {
+            return this->compare_nodes(a, b);
+        });
+    }
+
+    /**
+     * Combinação de Augment sobre os pares com chaves entre lo e hi,
+     * inclusive, em O(altura) (ver augment::range). Como em content_hash,
+     * valores alterados pelas referências de search ou dos iteradores não
+     * atualizam os agregados.
+     */
+    template<class KeyLike = K, class A = Augment>
+    typename A::value_type aggregate(const KeyLike& lo, const KeyLike& hi) const {
+        static_assert(has_aggregate, "aggregate requires an Augment policy such as augment::Sum.");
+        return this->range<A>(lo, hi);
+    }
+
+    /// Combinação de Augment sobre a árvore inteira, em O(1).
+    template<class A = Augment>
+    typename A::value_type aggregate() const {
+        static_assert(has_aggregate, "aggregate requires an Augment policy such as augment::Sum.");
+        this->require_tree();
+        return augment::summary<A>(this->root);
+    }
+
+    /// Número de chaves entre lo e hi, inclusive: a mesma consulta sobre size.
+    template<class KeyLike = K>
+    size_t count(const KeyLike& lo, const KeyLike& hi) const {
+        return this->range<augment::Count>(lo, hi);
+    }
+
+    iterator begin() {
+        this->require_tree();
+        Node* node = this->root;
+        while (node && node->m_left) {
+            node = node->m_left;
+        }
+        return iterator(node);
+    }
+
+    iterator end() {
+        return iterator();
+    }
+
+    const_iterator begin() const {
+        return const_cast<BST*>(this)->begin();
+    }
+
+    const_iterator end() const {
+        return const_iterator();
+    }
+
+    /// Retorna o nó com a chave ou end(), sem lançar exceções.
+    iterator find(const K& key) {
+        return iterator(this->access(this->find_node(key)));
+    }
+
+    const_iterator find(const K& key) const {
+        return const_iterator(this->find_node(key));
+    }
+
+    /// Busca por um tipo comparável com K, como std::string_view em chaves std::string.
+    template<class KeyLike, class C = Compare,
+             class = std::enable_if_t<cmp::is_transparent<C>::value>>
+    iterator find(const KeyLike& key) {
+        return iterator(this->access(this->find_node(key)));
+    }
+
+    template<class KeyLike, class C = Compare,
+             class = std::enable_if_t<cmp::is_transparent<C>::value>>
+    const_iterator find(const KeyLike& key) const {
+        return const_iterator(this->find_node(key));
+    }
+
+    /**
+     * Insere a chave se ela ainda não existir. Retorna o nó com a chave e se
+     * a inserção aconteceu; se a chave existir, o valor não é alterado.
+     */
+    template<class KeyType, class ValueType>
+    std::pair<iterator, bool> try_insert(KeyType&& key, ValueType&& value) {
+        return this->insert_unique(key, [&] {
+            return new Node(std::forward<KeyType>(key), std::forward<ValueType>(value));
+        });
+    }
+
+    /// Insere a chave ou, se ela existir, substitui o valor.
+    template<class KeyType, class ValueType>
+    std::pair<iterator, bool> insert_or_assign(KeyType&& key, ValueType&& value) {
+        std::pair<iterator, bool> result = this->try_insert(std::forward<KeyType>(key),
+                                                            std::forward<ValueType>(value));
+        if (!result.second) {
+            // Só chega aqui se try_insert não consumiu o valor
+            result.first->m_value = std::forward<ValueType>(value);
+            for (Node* node = result.first.get(); node; node = node->m_parent) {
+                augment::update(node);
             }
-        } else {
-            this->postorder_delete(this->root);
+            this->record(trace::Op::Insert, result.first->m_key, result.first->m_value);
         }
+        return result;
     }
 
-    Node* get_root() {
-        return this->root;
+    /// Como try_insert, mas o valor só é construído a partir de args se a chave for nova.
+    template<class KeyType, class... Args>
+    std::pair<iterator, bool> emplace(KeyType&& key, Args&&... args) {
+        return this->insert_unique(key, [&] {
+            return new Node(std::forward<KeyType>(key), V(std::forward<Args>(args)...));
+        });
+    }
+
+    /**
+     * Como try_insert, mas a busca começa em hint em vez da raiz: sobe por
+     * m_parent só até o ancestral cuja subárvore pode conter a chave e desce
+     * dali. Com chaves vizinhas da de hint, a busca não depende da altura;
+     * com end(), parte do maior nó. O size dos ancestrais ainda é atualizado
+     * até a raiz.
+     */
+    template<class KeyType, class ValueType>
+    std::pair<iterator, bool> insert_hint(const_iterator hint, KeyType&& key, ValueType&& value) {
+        Node* start = const_cast<Node*>(hint.get());
+        if (!start && this->root) {
+            start = this->last_node();
+        }
+        if (start) {
+            start = this->climb(start, probe(key), key);
+        }
+        return this->insert_unique(key, [&] {
+            return new Node(std::forward<KeyType>(key), std::forward<ValueType>(value));
+        }, start);
+    }
+
+    /**
+     * Insere uma sequência de chaves partindo sempre do nó da chave anterior,
+     * o que favorece sequências ordenadas ou quase ordenadas. Só é válido
+     * enquanto esse nó continuar na árvore.
+     */
+    class Inserter {
+     public:
+        explicit Inserter(BST& tree) : tree(tree), last(tree.end()) {}
+
+        template<class KeyType, class ValueType>
+        std::pair<iterator, bool> operator()(KeyType&& key, ValueType&& value) {
+            std::pair<iterator, bool> result = this->tree.insert_hint(this->last,
+                std::forward<KeyType>(key), std::forward<ValueType>(value));
+            this->last = result.first;
+            return result;
+        }
+
+     private:
+        BST& tree;
+        iterator last;
+    };
+
+    Inserter inserter() {
+        return Inserter(*this);
     }
 
     void insert(const K key, const V value) {
-        this->root = this->insert(key, value, this->root);
+        if (!this->try_insert(key, value).second) {
+            throw std::invalid_argument("Can't insert duplicated key" +
+                cmp::describe(key) + ".");
+        }
+    }
+
+    /**
+     * Deixa a árvore perfeitamente balanceada em tempo linear e sem memória
+     * extra (algoritmo Day-Stout-Warren): rotações à direita a transformam em
+     * uma lista ordenada pelos filhos da direita, que é então compactada por
+     * rotações à esquerda. As rotações mantêm size e m_parent corretos.
+     */
+    void rebalance() {
+        this->require_tree();
+        if (!this->root) {
+            return;
+        }
+        // A operação é gravada como um todo, não rotação por rotação
+        trace::Recorder<K, V>* tracer = this->tracer;
+        this->tracer = nullptr;
+        Node* node = this->root;
+        while (node) {
+            if (node->m_left) {
+                node = this->rotate_right(node);
+            } else {
+                node = node->m_right;
+            }
+        }
+        // Completa primeiro o último nível, depois compacta os de cima
+        size_t count = this->root->size;
+        size_t full = 1;
+        while (full * 2 + 1 <= count) {
+            full = full * 2 + 1;
+        }
+        this->compress(count - full);
+        while (full > 1) {
+            full /= 2;
+            this->compress(full);
+        }
+        this->tracer = tracer;
+        this->record(trace::Op::Rebalance, K(), V());
+    }
+
+    /**
+     * Chama rebalance automaticamente quando uma inserção deixa a árvore com
+     * altura maior que factor * log2(size). Com 0, o padrão, nunca chama.
+     */
+    void set_rebalance_factor(double factor) {
+        this->rebalance_factor = factor;
+    }
+
+    /**
+     * Move para a árvore retornada as chaves maiores ou iguais a key, ficando
+     * nesta apenas as menores. Leva O(log n) em árvores balanceadas.
+     */
+    template<class KeyLike = K>
+    BST split(const KeyLike& key) {
+        this->require_tree();
+        const auto prefix = probe(key);
+        auto [less, found, greater] = setops::split(this->root, [&](const Node* node) {
+            return this->compare_to(prefix, key, node);
+        });
+        BST result(this->compare);
+        result.root = found ? setops::join<Node>(nullptr, found, greater) : greater;
+        this->root = less;
+        this->record_bulk();
+        this->reindex();
+        if (this->index) {
+            result.enable_index();
+        }
+        return result;
+    }
+
+    /**
+     * Une duas árvores e uma nova chave, em que todas as chaves de left são
+     * menores que key e todas as de right são maiores. As árvores recebidas
+     * ficam vazias.
+     */
+    static BST join(BST&& left, K key, V value, BST&& right) {
+        left.require_tree();
+        right.require_tree();
+        Node* pivot = new Node(std::move(key), std::move(value));
+        if ((left.root && left.compare_nodes(left.last_node(), pivot) >= 0) ||
+            (right.root && left.compare_nodes(pivot, right.first_node()) >= 0)) {
+            delete pivot;
+            throw std::invalid_argument("Keys are not ordered for join.");
+        }
+        BST result(left.compare);
+        result.root = setops::join(left.root, pivot, right.root);
+        left.root = right.root = nullptr;
+        left.record_bulk();
+        right.record_bulk();
+        left.reindex();
+        right.reindex();
+        if (left.index) {
+            result.enable_index();
+        }
+        return result;
+    }
+
+    /// Une duas árvores em que todas as chaves de left são menores que as de right.
+    static BST join(BST&& left, BST&& right) {
+        left.require_tree();
+        right.require_tree();
+        if (left.root && right.root &&
+            left.compare_nodes(left.last_node(), right.first_node()) >= 0) {
+            throw std::invalid_argument("Keys are not ordered for join.");
+        }
+        BST result(left.compare);
+        result.root = setops::join2(left.root, right.root);
+        left.root = right.root = nullptr;
+        left.record_bulk();
+        right.record_bulk();
+        left.reindex();
+        right.reindex();
+        if (left.index) {
+            result.enable_index();
+        }
+        return result;
+    }
+
+    /**
+     * Adiciona as chaves de other, que fica vazia. Nas chaves que existem nas
+     * duas árvores, o valor de other substitui o desta. Com um pool, as
+     * metades de cada passo são processadas em paralelo.
+     */
+    void set_union(BST&& other, par::WorkStealingPool* pool = nullptr) {
+        this->set_operation(std::move(other), pool, [](Node* a, Node* b, const auto& context) {
+            return setops::unite(a, b, context);
+        });
+    }
+
+    /// Mantém apenas as chaves que também estão em other, que fica vazia.
+    void set_intersection(BST&& other, par::WorkStealingPool* pool = nullptr) {
+        this->set_operation(std::move(other), pool, [](Node* a, Node* b, const auto& context) {
+            return setops::intersect(a, b, context);
+        });
+    }
+
+    /// Remove as chaves que estão em other, que fica vazia.
+    void set_difference(BST&& other, par::WorkStealingPool* pool = nullptr) {
+        this->set_operation(std::move(other), pool, [](Node* a, Node* b, const auto& context) {
+            return setops::subtract(a, b, context);
+        });
+    }
+
+    /// Remove a chave, se existir. Os nós restantes continuam no mesmo endereço.
+    template<class KeyLike = K>
+    bool erase(const KeyLike& key) {
+        this->require_tree();
+        Node* node = this->find_node(key);
+        if (!node) {
+            return false;
+        }
+        // Primeiro nó, de baixo para cima, que perde um descendente
+        Node* start;
+        if (node->m_left && node->m_right) {
+            Node* successor = node->m_right;
+            while (successor->m_left) {
+                successor = successor->m_left;
+            }
+            start = successor;
+            if (successor->m_parent != node) {
+                start = successor->m_parent;
+                this->replace(successor, successor->m_right);
+                successor->m_right = node->m_right;
+                successor->m_right->m_parent = successor;
+            }
+            this->replace(node, successor);
+            successor->m_left = node->m_left;
+            successor->m_left->m_parent = successor;
+        } else {
+            start = node->m_parent;
+            this->replace(node, node->m_left ? node->m_left : node->m_right);
+        }
+        for (; start; start = start->m_parent) {
+            augment::update(start);
+        }
+        if (this->index) {
+            this->index->erase(node);
+        }
+        this->record(trace::Op::Erase, node->m_key, node->m_value);
+        delete node;
+        return true;
+    }
+
+    /**
+     * Passa a gravar as alterações da árvore em recorder, ou para de gravar se
+     * for nullptr. Um checkpoint do estado atual é salvo ao começar.
+     */
+    void set_tracer(trace::Recorder<K, V>* recorder) {
+        this->require_tree();
+        this->tracer = recorder;
+        if (recorder) {
+            recorder->add_checkpoint(recorder->sequence(), trace::encode_tree(this->root));
+        }
+    }
+
+    /// Constrói uma árvore perfeitamente balanceada a partir de chaves
+    /// ordenadas e sem repetição, em tempo linear.
+    void build_sorted(const K* keys, const V* values, size_t count) {
+        if (this->root) {
+            throw std::runtime_error("Tree is not empty.");
+        }
+        this->root = this->build_sorted(keys, values, 0, count);
+        this->reindex();
+        this->record_bulk();
     }
 
     V& search(const K key) {
-        Node* node = this->search(key, this->root);
+        Node* node = this->find_node(key);
         if (!node) {
-            throw std::invalid_argument("Key " + std::to_string(key) +
-                " not found.");
+            throw std::invalid_argument("Key" + cmp::describe(key) + " not found.");
         }
-        return node->m_value;
+        return this->access(node)->m_value;
     }
 
     void to_list() {
@@ -94,6 +724,7 @@ class BST {
             return;
         }
         this->is_list = true;
+        this->index.reset();
         std::vector<Node*> current_queue;
         std::vector<Node*> next_queue;
         std::vector<Node*>* cur = &current_queue;
@@ -146,6 +777,7 @@ class BST {
             next = temp;
             is_even = !is_even;
         } while (cur->size());
+        this->record_bulk();
     }
 
     void print_preorder() {
@@ -164,9 +796,10 @@ class BST {
     }
 
     void print_breadth() {
-        std::vector<Node*> queue(this->root->size);
+        std::vector<Node*> queue;
         Node* node;
         uint i = 0;
+        queue.reserve(this->root->size);
         queue.push_back(this->root);
         while (i < queue.size()) {
             node = queue[i++];
@@ -202,6 +835,8 @@ class BST {
             throw std::runtime_error("Tree is not empty.");
         }
         this->root = this->grow_doubles(1, max_k);
+        this->reindex();
+        this->record_bulk();
     }
 
     Node* grow_doubles(int k, int max_k) {
@@ -212,13 +847,12 @@ class BST {
         cur->m_left = this->grow_doubles(k * 2, max_k);
         if (cur->m_left) {
             cur->m_left->m_parent = cur;
-            cur->size += cur->m_left->size;
         }
         cur->m_right = this->grow_doubles(k * 2 + 1, max_k);
         if (cur->m_right) {
             cur->m_right->m_parent = cur;
-            cur->size += cur->m_right->size;
         }
+        augment::update(cur);
         return cur;
     }
 
@@ -244,50 +878,363 @@ class BST {
     Node* root;
     std::vector<K> keys;
     bool is_list;
+    trace::Recorder<K, V>* tracer;
+    double rebalance_factor;
+    Compare compare;
+    std::unique_ptr<lookup::Index<K, Node>> index;
 
-    Node* search(const K key, Node* node) {
-        if (!node) {
+    template<class Tree>
+    friend class trace::Replayer;
+
+    void record(trace::Op op, const K& key, const V& value) {
+        if constexpr (trace::is_traceable<K, V>) {
+            if (this->tracer && this->tracer->record(op, key, value)) {
+                this->tracer->add_checkpoint(this->tracer->sequence(),
+                    trace::encode_tree(this->root));
+            }
+        }
+    }
+
+    // Libera os nós sem gravar no trace, como o destrutor precisa
+    void destroy(par::WorkStealingPool* pool = nullptr) {
+        if (this->is_list) {
+            Node* current = this->root;
+            if (current) {
+                Node* next = current->m_right;
+                while (next) {
+                    delete current;
+                    current = next;
+                    next = current->m_right;
+                }
+                delete current;
+            }
+        } else if (pool) {
+            par::parallel_destroy(*pool, this->root);
+        } else {
+            par::destroy_serial(this->root);
+        }
+        this->root = nullptr;
+        this->is_list = false;
+        if (this->index) {
+            this->index->clear();
+        }
+    }
+
+    // Coloca other no lugar de node em relação ao pai de node
+    void replace(Node* node, Node* other) {
+        Node* parent = node->m_parent;
+        if (!parent) {
+            this->root = other;
+        } else if (parent->m_left == node) {
+            parent->m_left = other;
+        } else {
+            parent->m_right = other;
+        }
+        if (other) {
+            other->m_parent = parent;
+        }
+    }
+
+    static uint size_of(const Node* node) {
+        return node ? node->size : 0;
+    }
+
+    Node* build_sorted(const K* keys, const V* values, size_t begin, size_t end) {
+        if (begin >= end) {
             return nullptr;
         }
-        if (key == node->m_key) {
+        size_t middle = begin + (end - begin) / 2;
+        Node* node = new Node(keys[middle], values[middle]);
+        node->m_left = this->build_sorted(keys, values, begin, middle);
+        node->m_right = this->build_sorted(keys, values, middle + 1, end);
+        if (node->m_left) {
+            node->m_left->m_parent = node;
+        }
+        if (node->m_right) {
+            node->m_right->m_parent = node;
+        }
+        augment::update(node);
+        return node;
+    }
+
+    static Node* copy_node(const Node* node) {
+        Node* copy = new Node(node->m_key, node->m_value);
+        copy->size = node->size;
+        if constexpr (has_hash) {
+            copy->m_hash = node->m_hash;
+        }
+        if constexpr (has_aggregate) {
+            copy->m_aggregate = node->m_aggregate;
+        }
+        return copy;
+    }
+
+    // Prefixo da chave buscada, calculado uma vez por busca
+    template<class KeyLike>
+    static auto probe(const KeyLike& key) {
+        if constexpr (has_prefix) {
+            return Compare::prefix(key);
+        } else {
+            return 0;
+        }
+    }
+
+    int compare_nodes(const Node* a, const Node* b) const {
+        if constexpr (has_prefix) {
+            if (a->m_prefix != b->m_prefix) {
+                return a->m_prefix < b->m_prefix ? -1 : 1;
+            }
+        }
+        return this->compare(a->m_key, b->m_key);
+    }
+
+    Node* first_node() const {
+        Node* node = this->root;
+        while (node->m_left) {
+            node = node->m_left;
+        }
+        return node;
+    }
+
+    Node* last_node() const {
+        Node* node = this->root;
+        while (node->m_right) {
+            node = node->m_right;
+        }
+        return node;
+    }
+
+    template<class Operation>
+    void set_operation(BST&& other, par::WorkStealingPool* pool, Operation operation) {
+        this->require_tree();
+        other.require_tree();
+        auto compare = [this](const Node* a, const Node* b) {
+            return this->compare_nodes(a, b);
+        };
+        setops::Context<decltype(compare)> context{compare, pool, 1 << 14};
+        this->root = operation(this->root, other.root, context);
+        other.root = nullptr;
+        this->record_bulk();
+        other.record_bulk();
+        this->reindex();
+        other.reindex();
+    }
+
+    // Refaz o índice depois de alterações que não passam por insert_unique e erase
+    void reindex() {
+        if (this->index) {
+            this->index->clear();
+            this->index->reserve(size_of(this->root));
+            par::for_each_serial(this->root, [this](Node* node) {
+                this->index->insert(node);
+            });
+        }
+    }
+
+    /**
+     * Operações em lote não são gravadas evento a evento: um evento Bulk marca
+     * o ponto em que o replay deve recomeçar do checkpoint salvo logo depois.
+     * Depois de to_list não há árvore para salvar, então o replay dos estados
+     * seguintes falha até o próximo checkpoint, em vez de montar um estado
+     * errado.
+     */
+    void record_bulk() {
+        if constexpr (trace::is_traceable<K, V>) {
+            if (this->tracer && this->tracer->is_active()) {
+                this->tracer->record(trace::Op::Bulk, K(), V());
+                if (!this->is_list) {
+                    this->tracer->add_checkpoint(this->tracer->sequence(),
+                        trace::encode_tree(this->root));
+                }
+            }
+        }
+    }
+
+    template<class Policy, class KeyLike>
+    typename Policy::value_type range(const KeyLike& lo, const KeyLike& hi) const {
+        this->require_tree();
+        const auto lo_prefix = probe(lo);
+        const auto hi_prefix = probe(hi);
+        return augment::range<Policy>(this->root,
+            [&](const Node* node) {
+                return this->compare_to(lo_prefix, lo, node) <= 0;
+            },
+            [&](const Node* node) {
+                return this->compare_to(hi_prefix, hi, node) >= 0;
+            });
+    }
+
+    template<class Probe, class KeyLike>
+    int compare_to(const Probe& probe, const KeyLike& key, const Node* node) const {
+        if constexpr (has_prefix) {
+            if (probe != node->m_prefix) {
+                return probe < node->m_prefix ? -1 : 1;
+            }
+        }
+        return this->compare(key, node->m_key);
+    }
+
+    template<class KeyLike>
+    Node* find_node(const KeyLike& key) const {
+        if constexpr (std::is_same<KeyLike, K>::value) {
+            if (this->index) {
+                return this->index->find(key, [this](const K& key, const Node* node) {
+                    return this->compare(key, node->m_key) == 0;
+                });
+            }
+        }
+        const auto prefix = probe(key);
+        Node* node = this->root;
+        while (node) {
+            int order = this->compare_to(prefix, key, node);
+            if (order < 0) {
+                node = node->m_left;
+            } else if (order > 0) {
+                node = node->m_right;
+            } else {
+                return node;
+            }
+        }
+        return nullptr;
+    }
+
+    // Aplica a política de acesso ao nó encontrado por uma busca
+    Node* access(Node* node) {
+        if constexpr (Access::adaptive) {
+            if (node) {
+                Access::access(node, [this](Node* child) {
+                    Node* parent = child->m_parent;
+                    if (parent->m_left == child) {
+                        this->rotate_right(parent);
+                    } else {
+                        this->rotate_left(parent);
+                    }
+                });
+            }
+        }
+        return node;
+    }
+
+    /**
+     * Sobe de node até um nó cuja subárvore cubra a chave. Enquanto node sobe
+     * do lado da chave, ele continua abaixo do mesmo limite; o primeiro
+     * ancestral do outro lado é o limite, e só se a chave passar dele a
+     * subida continua a partir dele. Cada nó do caminho é visitado uma vez.
+     */
+    template<class Probe, class KeyLike>
+    Node* climb(Node* node, const Probe& prefix, const KeyLike& key) const {
+        int order = this->compare_to(prefix, key, node);
+        if (order == 0) {
             return node;
         }
-        if (key > node->m_key) {
-            return this->search(key, node->m_right);
+        while (true) {
+            Node* child = node;
+            Node* bound = node->m_parent;
+            while (bound && (order > 0 ? bound->m_right : bound->m_left) == child) {
+                child = bound;
+                bound = bound->m_parent;
+            }
+            if (!bound) {
+                return node;
+            }
+            int side = this->compare_to(prefix, key, bound);
+            if (side == 0) {
+                return bound;
+            }
+            if ((side > 0) != (order > 0)) {
+                return node;
+            }
+            node = bound;
         }
-        return this->search(key, node->m_left);
     }
 
+    /**
+     * Busca a posição da chave sem recursão, a partir de start ou da raiz, e,
+     * se ela não existir, liga o nó criado por make, atualiza size dos
+     * ancestrais e grava o evento.
+     */
+    template<class KeyLike, class Make>
+    std::pair<iterator, bool> insert_unique(const KeyLike& key, Make make, Node* start = nullptr) {
+        this->require_tree();
+        const auto prefix = probe(key);
+        Node* parent = nullptr;
+        Node** link = &this->root;
+        if (start && start->m_parent) {
+            parent = start->m_parent;
+            link = parent->m_left == start ? &parent->m_left : &parent->m_right;
+        }
+        while (*link) {
+            parent = *link;
+            int order = this->compare_to(prefix, key, parent);
+            if (order < 0) {
+                link = &parent->m_left;
+            } else if (order > 0) {
+                link = &parent->m_right;
+            } else {
+                return {iterator(parent), false};
+            }
+        }
+        Node* node = make();
+        node->m_parent = parent;
+        *link = node;
+        if (this->index) {
+            this->index->insert(node);
+        }
+        uint depth = 0;
+        for (; parent; parent = parent->m_parent) {
+            ++parent->size;
+            if constexpr (has_hash) {
+                parent->m_hash += node->m_hash;
+            }
+            augment::combine(parent);
+            ++depth;
+        }
+        this->record(trace::Op::Insert, node->m_key, node->m_value);
+        // Só o nó novo pode ter aumentado a altura da árvore
+        if (this->rebalance_factor > 0 &&
+            depth > this->rebalance_factor * std::log2(this->root->size + 1.0)) {
+            this->rebalance();
+        }
+        return {iterator(node), true};
+    }
+
+    // As rotações religam o pai e corrigem size, o hash e o agregado; retornam a nova raiz da subárvore
     Node* rotate_right(Node* node) {
         Node* other = node->m_left;
         node->m_left = other->m_right;
+        if (node->m_left) {
+            node->m_left->m_parent = node;
+        }
+        this->replace(node, other);
         other->m_right = node;
+        node->m_parent = other;
+        augment::update(node);
+        augment::update(other);
+        this->record(trace::Op::RotateRight, node->m_key, node->m_value);
         return other;
     }
 
     Node* rotate_left(Node* node) {
         Node* other = node->m_right;
         node->m_right = other->m_left;
+        if (node->m_right) {
+            node->m_right->m_parent = node;
+        }
+        this->replace(node, other);
         other->m_left = node;
+        node->m_parent = other;
+        augment::update(node);
+        augment::update(other);
+        this->record(trace::Op::RotateLeft, node->m_key, node->m_value);
         return other;
     }
 
-    Node* insert(const K key, const V value, Node* node) {
-        if (!node) {
-            return new Node(key, value);
-        }
-        if (key < node->m_key) {
-            node->m_left = this->insert(key, value, node->m_left);
-            node->m_left->m_parent = node;
-        } else if (key > node->m_key) {
-            node->m_right = this->insert(key, value, node->m_right);
-            node->m_right->m_parent = node;
-        } else {
-            throw std::invalid_argument("Can't insert duplicated key " +
-                std::to_string(key) + ".");
+    // Rotações à esquerda em count nós alternados da lista, a partir da raiz
+    void compress(size_t count) {
+        Node* node = this->root;
+        for (size_t i = 0; i < count; ++i) {
+            node = this->rotate_left(node)->m_right;
         }
-        ++node->size;
-        return node;
     }
 
     void print(const std::string& prefix, Node* node, bool is_left) const {
@@ -350,14 +1297,6 @@ class BST {
             }
         }
     }
-    
-    void postorder_delete(Node* node) {
-        if (node) {
-            postorder_delete(node->m_left);
-            postorder_delete(node->m_right);
-            delete node;
-        }
-    }
 };
 
 #endif  // BST_HPP_
@@ -0,0 +1,79 @@
+#ifndef ADAPT_HPP_
+#define ADAPT_HPP_
+
+#include <climits>
+
+/*
+    Políticas de acesso da BST, escolhidas pelo quarto parâmetro de template.
+    Uma política adaptativa é chamada a cada busca bem-sucedida feita por
+    find ou search (não constantes) com o nó encontrado e uma função que o
+    rotaciona para cima do pai, de modo que chaves acessadas com frequência
+    fiquem mais perto da raiz. As rotações da árvore mantêm size e m_parent e
+    são gravadas pelo tracer. Com a política padrão, nada disso é compilado.
+*/
+
+namespace adapt {
+
+/// Buscas não alteram a árvore.
+struct None {
+    static constexpr bool adaptive = false;
+    static constexpr bool counts = false;
+};
+
+/**
+ * Semi-splay (Sleator e Tarjan): sobe o nó acessado dois níveis por vez, e
+ * em cada par de níveis alinhados só o pai sobe, o que reduz à metade a
+ * profundidade do caminho com metade das rotações de um splay completo.
+ */
+struct SemiSplay {
+    static constexpr bool adaptive = true;
+    static constexpr bool counts = false;
+
+    template<class Node, class RotateUp>
+    static void access(Node* node, RotateUp rotate_up) {
+        while (node->m_parent && node->m_parent->m_parent) {
+            Node* parent = node->m_parent;
+            Node* grandparent = parent->m_parent;
+            if ((grandparent->m_left == parent) == (parent->m_left == node)) {
+                rotate_up(parent);
+                node = parent;
+            } else {
+                rotate_up(node);
+                rotate_up(node);
+            }
+        }
+    }
+};
+
+/**
+ * Cada nó conta seus acessos e sobe enquanto tiver mais acessos que o pai,
+ * aproximando a árvore ótima para uma distribuição de acessos estável. Um
+ * acesso faz no máximo as rotações necessárias para reordenar o caminho.
+ */
+struct Frequency {
+    static constexpr bool adaptive = true;
+    static constexpr bool counts = true;
+
+    template<class Node, class RotateUp>
+    static void access(Node* node, RotateUp rotate_up) {
+        if (node->m_hits < UINT_MAX) {
+            ++node->m_hits;
+        }
+        while (node->m_parent && node->m_hits > node->m_parent->m_hits) {
+            rotate_up(node);
+        }
+    }
+};
+
+/// Campo opcional dos nós com a quantidade de acessos.
+template<bool enabled>
+struct HitsField {
+    unsigned m_hits = 0;
+};
+
+template<>
+struct HitsField<false> {};
+
+}  // namespace adapt
+
+#endif  // ADAPT_HPP_
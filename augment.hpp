@@ -0,0 +1,266 @@
+#ifndef AUGMENT_HPP_
+#define AUGMENT_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+#include "./merkle.hpp"
+
+/*
+    Agregados de subárvore da BST, escolhidos pelo sexto parâmetro de
+    template. Uma política define um monoide: value_type, identity(),
+    combine(a, b) associativo e of(chave, valor) com o valor de um par. Cada
+    nó guarda em m_aggregate a combinação dos pares da sua subárvore, na
+    ordem das chaves, e aggregate(lo, hi) combina as chaves de um intervalo
+    em O(altura), juntando os agregados das subárvores inteiramente dentro
+    dele nos dois caminhos que partem do nó onde as buscas por lo e hi se
+    separam. Como combine não precisa ser comutativo, a ordem é preservada.
+
+    O size dos nós é a política Count, que não ocupa campo extra: a consulta
+    de intervalo sobre ela lê size, e update recalcula size, m_aggregate e o
+    hash de merkle.hpp juntos. Inserções, remoções, rotações, join e split
+    passam todos por update, então os agregados valem nas mesmas situações
+    em que size vale.
+
+    Exemplo, total de bytes por intervalo de chaves:
+        struct Bytes {
+            static constexpr bool enabled = true;
+            using value_type = uint64_t;
+            static value_type identity() { return 0; }
+            static value_type combine(value_type a, value_type b) { return a + b; }
+            static value_type of(const std::string&, const Blob& blob) { return blob.size(); }
+        };
+        BST<std::string, Blob, cmp::ThreeWay, adapt::None, merkle::None, Bytes> tree;
+        uint64_t bytes = tree.aggregate("a", "b");
+*/
+
+namespace augment {
+
+/// Nós sem agregado além de size.
+struct None {
+    static constexpr bool enabled = false;
+};
+
+/// Número de pares, guardado no campo size que todo nó já tem.
+struct Count {
+    static constexpr bool enabled = true;
+    using value_type = size_t;
+
+    static value_type identity() {
+        return 0;
+    }
+
+    static value_type combine(value_type a, value_type b) {
+        return a + b;
+    }
+
+    template<class K, class V>
+    static value_type of(const K&, const V&) {
+        return 1;
+    }
+};
+
+/// Soma dos valores convertidos para T.
+template<class T>
+struct Sum {
+    static constexpr bool enabled = true;
+    using value_type = T;
+
+    static value_type identity() {
+        return T();
+    }
+
+    static value_type combine(const value_type& a, const value_type& b) {
+        return a + b;
+    }
+
+    template<class K, class V>
+    static value_type of(const K&, const V& value) {
+        return static_cast<T>(value);
+    }
+};
+
+/// Menor valor; sem pares, o maior valor de T.
+template<class T>
+struct Min {
+    static constexpr bool enabled = true;
+    using value_type = T;
+
+    static value_type identity() {
+        return std::numeric_limits<T>::max();
+    }
+
+    static value_type combine(const value_type& a, const value_type& b) {
+        return std::min(a, b);
+    }
+
+    template<class K, class V>
+    static value_type of(const K&, const V& value) {
+        return static_cast<T>(value);
+    }
+};
+
+/// Maior valor; sem pares, o menor valor de T.
+template<class T>
+struct Max {
+    static constexpr bool enabled = true;
+    using value_type = T;
+
+    static value_type identity() {
+        return std::numeric_limits<T>::lowest();
+    }
+
+    static value_type combine(const value_type& a, const value_type& b) {
+        return std::max(a, b);
+    }
+
+    template<class K, class V>
+    static value_type of(const K&, const V& value) {
+        return static_cast<T>(value);
+    }
+};
+
+/// Duas políticas ao mesmo tempo, como Min e Max, em um std::pair.
+template<class First, class Second>
+struct Both {
+    static constexpr bool enabled = true;
+    using value_type = std::pair<typename First::value_type, typename Second::value_type>;
+
+    static value_type identity() {
+        return {First::identity(), Second::identity()};
+    }
+
+    static value_type combine(const value_type& a, const value_type& b) {
+        return {First::combine(a.first, b.first), Second::combine(a.second, b.second)};
+    }
+
+    template<class K, class V>
+    static value_type of(const K& key, const V& value) {
+        return {First::of(key, value), Second::of(key, value)};
+    }
+};
+
+template<class Policy>
+constexpr bool stored = Policy::enabled && !std::is_same<Policy, Count>::value;
+
+/// Campo opcional dos nós com o agregado da subárvore.
+template<class Policy, bool enabled = stored<Policy>>
+struct AggregateField {
+    using augment = Policy;
+    typename Policy::value_type m_aggregate = Policy::identity();
+};
+
+template<class Policy>
+struct AggregateField<Policy, false> {};
+
+template<class Node, class = void>
+struct is_aggregated : std::false_type {};
+
+template<class Node>
+struct is_aggregated<Node, std::void_t<decltype(std::declval<Node&>().m_aggregate)>> : std::true_type {};
+
+/// Agregado da subárvore segundo a política; Count lê size.
+template<class Policy, class Node>
+typename Policy::value_type summary(const Node* node) {
+    if (!node)
+        return Policy::identity();
+    if constexpr (std::is_same<Policy, Count>::value)
+        return node->size;
+    else
+        return node->m_aggregate;
+}
+
+/// Valor só do par do nó, sem os filhos.
+template<class Policy, class Node>
+typename Policy::value_type entry(const Node* node) {
+    return Policy::of(node->m_key, node->m_value);
+}
+
+/// Recalcula m_aggregate a partir dos filhos. Não faz nada em nós sem agregado.
+template<class Node>
+void combine(Node* node) {
+    if constexpr (is_aggregated<Node>::value) {
+        using Policy = typename Node::augment;
+        node->m_aggregate = Policy::combine(
+            Policy::combine(summary<Policy>(node->m_left), entry<Policy>(node)),
+            summary<Policy>(node->m_right));
+    }
+}
+
+/// Recalcula size, o agregado e o hash do nó a partir dos filhos.
+template<class Node>
+void update(Node* node) {
+    node->size = 1 + summary<Count>(node->m_left) + summary<Count>(node->m_right);
+    augment::combine(node);
+    merkle::update(node);
+}
+
+/// Recalcula os campos de uma árvore inteira em pós-ordem, sem recursão.
+template<class Node>
+void rebuild(Node* root) {
+    if (!root)
+        return;
+    auto first = [](Node* node) {
+        while (node->m_left || node->m_right)
+            node = node->m_left ? node->m_left : node->m_right;
+        return node;
+    };
+    Node* node = first(root);
+    while (true) {
+        augment::update(node);
+        if (node == root)
+            return;
+        Node* parent = node->m_parent;
+        node = parent->m_left == node && parent->m_right ? first(parent->m_right) : parent;
+    }
+}
+
+/**
+ * Combina os pares com chaves entre lo e hi, inclusive, em O(altura).
+ * from_lo(nó) diz se a chave do nó é maior ou igual a lo, e to_hi(nó), se é
+ * menor ou igual a hi.
+ */
+template<class Policy, class Node, class FromLo, class ToHi>
+typename Policy::value_type range(const Node* root, FromLo from_lo, ToHi to_hi) {
+    // Nó em que os caminhos até lo e hi se separam
+    const Node* split = root;
+    while (split) {
+        if (!from_lo(split))
+            split = split->m_right;
+        else if (!to_hi(split))
+            split = split->m_left;
+        else
+            break;
+    }
+    if (!split)
+        return Policy::identity();
+    // À esquerda, cada nó encontrado tem chaves menores que as já somadas
+    typename Policy::value_type left = Policy::identity();
+    for (const Node* node = split->m_left; node;) {
+        if (from_lo(node)) {
+            left = Policy::combine(
+                Policy::combine(entry<Policy>(node), summary<Policy>(node->m_right)), left);
+            node = node->m_left;
+        } else {
+            node = node->m_right;
+        }
+    }
+    typename Policy::value_type right = Policy::identity();
+    for (const Node* node = split->m_right; node;) {
+        if (to_hi(node)) {
+            right = Policy::combine(
+                right, Policy::combine(summary<Policy>(node->m_left), entry<Policy>(node)));
+            node = node->m_right;
+        } else {
+            node = node->m_left;
+        }
+    }
+    return Policy::combine(Policy::combine(left, entry<Policy>(split)), right);
+}
+
+}  // namespace augment
+
+#endif  // AUGMENT_HPP_
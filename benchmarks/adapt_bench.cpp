@@ -0,0 +1,74 @@
+#include "../BST.hpp"
+#include "./bench.hpp"
+
+#include <memory>
+
+/*
+    Políticas de acesso: buscas com distribuição uniforme ou Zipf(0.99) em
+    uma árvore montada em ordem aleatória, sem adaptação, com semi-splay e
+    com contagem de acessos. Além do tempo por busca, mostra a média de
+    comparações por busca, medida em outra árvore com as mesmas chaves e
+    buscas depois de uma passada de aquecimento. Exemplo:
+        ./adapt_bench --sizes=1000000 --dist=random,zipfian --json
+*/
+
+// Conta as comparações, que são feitas uma vez por nível da busca
+struct CountingCompare : cmp::ThreeWay {
+    static inline size_t calls = 0;
+
+    template<class A, class B>
+    int operator()(const A& a, const B& b) const {
+        ++calls;
+        return cmp::ThreeWay::operator()(a, b);
+    }
+};
+
+template<class Access>
+static void measure(bench::Runner& runner, const std::string& name, bench::Distribution distribution,
+                    const std::vector<int>& keys, const std::vector<int>& lookups) {
+    BST<int, int, cmp::ThreeWay, Access> tree;
+    for (int key : keys)
+        tree.try_insert(key, key);
+    bench::Result& result = runner.run(name, distribution, keys.size(), nullptr, [&] {
+        long sum = 0;
+        for (int key : lookups)
+            sum += tree.find(key)->m_value;
+        bench::do_not_optimize(sum);
+        return lookups.size();
+    });
+
+    BST<int, int, CountingCompare, Access> counted;
+    for (int key : keys)
+        counted.try_insert(key, key);
+    for (int pass = 0; pass < 2; ++pass) {
+        CountingCompare::calls = 0;
+        for (int key : lookups)
+            counted.find(key);
+    }
+    result.extra.emplace_back("comparisons", static_cast<double>(CountingCompare::calls) / lookups.size());
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {100000, 1000000};
+    defaults.distributions = {bench::Distribution::Random, bench::Distribution::Zipfian};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        std::vector<int> keys = bench::make_keys(n, bench::Distribution::Random);
+        // As chaves quentes não devem ser as primeiras inseridas, que ficam perto da raiz
+        std::vector<int> shuffled(keys);
+        std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937_64(1));
+        for (bench::Distribution distribution : options.distributions) {
+            std::vector<int> lookups = bench::make_lookups(shuffled, n, distribution);
+            if (options.selected("adapt.none"))
+                measure<adapt::None>(runner, "adapt.none", distribution, keys, lookups);
+            if (options.selected("adapt.semi_splay"))
+                measure<adapt::SemiSplay>(runner, "adapt.semi_splay", distribution, keys, lookups);
+            if (options.selected("adapt.frequency"))
+                measure<adapt::Frequency>(runner, "adapt.frequency", distribution, keys, lookups);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include "../BST.hpp"
+#include "./bench.hpp"
+
+/*
+    Agregados de subárvore: custo da inserção com e sem augment::Sum e tempo
+    de uma soma dos valores das chaves em [lo, hi], com cada intervalo
+    cobrindo um décimo das chaves. Compara aggregate(lo, hi) com percorrer a
+    árvore inteira, como antes, e com percorrer só o intervalo a partir de
+    find(lo). Os tempos de soma são por consulta.
+        ./aggregate_bench --sizes=1000000 --dist=random --json
+*/
+
+using Plain = BST<int, int>;
+using Summed = BST<int, int, cmp::ThreeWay, adapt::None, merkle::None, augment::Sum<int64_t>>;
+
+template<class Tree>
+static void measure_insert(bench::Runner& runner, const std::string& name,
+                           bench::Distribution distribution, const std::vector<int>& keys) {
+    Tree tree;
+    runner.run(name, distribution, keys.size(), [&] { tree.clear(); }, [&] {
+        for (int key : keys)
+            tree.insert(key, key);
+        return keys.size();
+    });
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {100000, 1000000};
+    defaults.distributions = {bench::Distribution::Random};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            std::vector<int> keys = bench::make_keys(n, distribution);
+            if (options.selected("bst.insert"))
+                measure_insert<Plain>(runner, "bst.insert", distribution, keys);
+            if (options.selected("bst.sum.insert"))
+                measure_insert<Summed>(runner, "bst.sum.insert", distribution, keys);
+
+            Summed tree;
+            for (int key : keys)
+                tree.insert(key, key);
+            // As chaves são 0..n-1; cada intervalo tem n / 10 chaves
+            const int width = static_cast<int>(std::max<size_t>(n / 10, 1));
+            std::mt19937_64 gen(7);
+            std::uniform_int_distribution<int> start(0, static_cast<int>(n) - width);
+            std::vector<std::pair<int, int>> ranges(1000);
+            for (auto& range : ranges) {
+                range.first = start(gen);
+                range.second = range.first + width - 1;
+            }
+
+            if (options.selected("sum.aggregate")) {
+                runner.run("sum.aggregate", distribution, n, nullptr, [&] {
+                    for (const auto& range : ranges)
+                        bench::do_not_optimize(tree.aggregate(range.first, range.second));
+                    return ranges.size();
+                });
+            }
+            if (options.selected("sum.scan")) {
+                runner.run("sum.scan", distribution, n, nullptr, [&] {
+                    for (const auto& range : ranges) {
+                        int64_t sum = 0;
+                        for (auto it = tree.find(range.first); it != tree.end() && it->m_key <= range.second; ++it)
+                            sum += it->m_value;
+                        bench::do_not_optimize(sum);
+                    }
+                    return ranges.size();
+                });
+            }
+            if (options.selected("sum.traversal")) {
+                // Uma árvore inteira por consulta; poucas consultas bastam
+                const size_t count = 10;
+                runner.run("sum.traversal", distribution, n, nullptr, [&] {
+                    for (size_t i = 0; i < count; ++i) {
+                        const auto& range = ranges[i];
+                        bench::do_not_optimize(tree.reduce(int64_t(0),
+                            [&](int key, int value) {
+                                return key >= range.first && key <= range.second ? int64_t(value) : 0;
+                            },
+                            [](int64_t a, int64_t b) { return a + b; }));
+                    }
+                    return count;
+                });
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,375 @@
+#ifndef BENCHMARKS_BENCH_HPP_
+#define BENCHMARKS_BENCH_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Utilitários compartilhados pelos benchmarks: geração de chaves, medição de
+/// tempo e saída em JSON, sem depender de janela ou contexto OpenGL.
+namespace bench {
+
+enum class Distribution {
+    Random,
+    Sorted,
+    NearlySorted,
+    Zipfian
+};
+
+inline const char* name(Distribution distribution) {
+    switch (distribution) {
+        case Distribution::Random: return "random";
+        case Distribution::Sorted: return "sorted";
+        case Distribution::NearlySorted: return "nearly_sorted";
+        case Distribution::Zipfian: return "zipfian";
+    }
+    return "unknown";
+}
+
+inline Distribution parse_distribution(const std::string& text) {
+    if (text == "random")
+        return Distribution::Random;
+    if (text == "sorted")
+        return Distribution::Sorted;
+    if (text == "nearly_sorted" || text == "nearly")
+        return Distribution::NearlySorted;
+    if (text == "zipfian" || text == "zipf")
+        return Distribution::Zipfian;
+    throw std::invalid_argument("Distribuição desconhecida: " + text + ".");
+}
+
+/// Gera índices em [0, n) com probabilidade proporcional a 1 / (rank + 1)^s.
+class Zipf {
+ public:
+    Zipf(size_t n, double s = 0.99) : cdf(n) {
+        double sum = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            sum += 1.0 / std::pow(i + 1.0, s);
+            this->cdf[i] = sum;
+        }
+        for (double& value : this->cdf)
+            value /= sum;
+    }
+
+    template<class Generator>
+    size_t operator()(Generator& gen) {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+        return std::lower_bound(this->cdf.begin(), this->cdf.end(), u) - this->cdf.begin();
+    }
+
+ private:
+    std::vector<double> cdf;
+};
+
+/**
+ * Gera n chaves distintas na ordem em que devem ser inseridas.
+ * Random é uma permutação uniforme, Sorted é crescente (e gera uma árvore
+ * degenerada), NearlySorted é crescente com cada chave trocada com uma das 8
+ * seguintes (também quase degenerada) e Zipfian insere primeiro as chaves que aparecem antes em um
+ * fluxo com distribuição de Zipf, de modo que as chaves quentes ficam perto
+ * da raiz, completando com as chaves restantes em ordem aleatória.
+ */
+inline std::vector<int> make_keys(size_t n, Distribution distribution, unsigned seed = 42) {
+    std::mt19937_64 gen(seed);
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    if (distribution == Distribution::Sorted)
+        return keys;
+    if (distribution == Distribution::NearlySorted) {
+        for (size_t i = 0; i + 1 < n; ++i) {
+            size_t j = std::min(n - 1, i + std::uniform_int_distribution<size_t>(0, 8)(gen));
+            std::swap(keys[i], keys[j]);
+        }
+        return keys;
+    }
+    std::shuffle(keys.begin(), keys.end(), gen);
+    if (distribution == Distribution::Random)
+        return keys;
+
+    Zipf zipf(n);
+    std::vector<int> order;
+    std::vector<bool> used(n, false);
+    order.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        size_t rank = zipf(gen);
+        if (!used[rank]) {
+            used[rank] = true;
+            order.push_back(keys[rank]);
+        }
+    }
+    for (size_t rank = 0; rank < n; ++rank) {
+        if (!used[rank])
+            order.push_back(keys[rank]);
+    }
+    return order;
+}
+
+/// Gera uma sequência de consultas às chaves dadas, seguindo a distribuição.
+inline std::vector<int> make_lookups(const std::vector<int>& keys, size_t count,
+                                     Distribution distribution, unsigned seed = 7) {
+    std::mt19937_64 gen(seed);
+    std::vector<int> lookups(count);
+    if (distribution == Distribution::Sorted || distribution == Distribution::NearlySorted) {
+        std::vector<int> sorted(keys);
+        std::sort(sorted.begin(), sorted.end());
+        for (size_t i = 0; i < count; ++i)
+            lookups[i] = sorted[i % sorted.size()];
+    } else if (distribution == Distribution::Random) {
+        std::uniform_int_distribution<size_t> uniform(0, keys.size() - 1);
+        for (size_t i = 0; i < count; ++i)
+            lookups[i] = keys[uniform(gen)];
+    } else {
+        // Em make_keys, as chaves mais quentes são as primeiras da ordem de inserção
+        Zipf zipf(keys.size());
+        for (size_t i = 0; i < count; ++i)
+            lookups[i] = keys[zipf(gen)];
+    }
+    return lookups;
+}
+
+/// Impede que o compilador elimine um valor calculado apenas para medição.
+template<class T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+using clock = std::chrono::steady_clock;
+
+inline double elapsed_ns(clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+}
+
+/// Resultado de um benchmark: tempo por operação de cada repetição.
+struct Result {
+    std::string name;
+    std::string distribution;
+    size_t size;
+    size_t operations;
+    std::vector<double> ns_per_op;
+    // Campos adicionais específicos de cada benchmark, como bytes por chave
+    std::vector<std::pair<std::string, double>> extra;
+
+    double min() const {
+        return *std::min_element(this->ns_per_op.begin(), this->ns_per_op.end());
+    }
+
+    double median() const {
+        std::vector<double> sorted(this->ns_per_op);
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[sorted.size() / 2];
+    }
+};
+
+/// Opções de linha de comando comuns a todos os executáveis de benchmark.
+struct Options {
+    std::vector<size_t> sizes{1000, 10000, 100000};
+    std::vector<Distribution> distributions{
+        Distribution::Random, Distribution::Sorted, Distribution::Zipfian};
+    // Distribuições degeneradas (ordenadas) têm custo quadrático, então são limitadas
+    size_t max_degenerate = 10000;
+    int repetitions = 5;
+    // Quantidades de threads para benchmarks paralelos: 1, 2, 4, ... até todas
+    std::vector<unsigned> threads = default_threads();
+    std::string json_path;
+    std::string filter;
+
+    static Options parse(int argc, char** argv) {
+        return parse(argc, argv, Options());
+    }
+
+    /// Lê as opções da linha de comando, partindo dos valores padrão dados.
+    static Options parse(int argc, char** argv, Options options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg(argv[i]);
+            std::string value;
+            size_t equals = arg.find('=');
+            if (equals != std::string::npos) {
+                value = arg.substr(equals + 1);
+                arg = arg.substr(0, equals);
+            }
+            if (arg == "--sizes") {
+                options.sizes.clear();
+                for (const std::string& item : split(value))
+                    options.sizes.push_back(std::stoull(item));
+            } else if (arg == "--dist") {
+                options.distributions.clear();
+                for (const std::string& item : split(value))
+                    options.distributions.push_back(parse_distribution(item));
+            } else if (arg == "--threads") {
+                options.threads.clear();
+                for (const std::string& item : split(value))
+                    options.threads.push_back(std::max(1, std::stoi(item)));
+            } else if (arg == "--reps") {
+                options.repetitions = std::max(1, std::stoi(value));
+            } else if (arg == "--max-degenerate") {
+                options.max_degenerate = std::stoull(value);
+            } else if (arg == "--json") {
+                options.json_path = value.empty() ? "-" : value;
+            } else if (arg == "--filter") {
+                options.filter = value;
+            } else {
+                std::cerr << "Uso: " << argv[0] << " [--sizes=N,...] [--dist=random,sorted,nearly_sorted,zipfian]"
+                    " [--reps=N] [--threads=N,...] [--max-degenerate=N] [--filter=texto] [--json[=arquivo]]"
+                    << std::endl;
+                std::exit(arg == "--help" ? 0 : 1);
+            }
+        }
+        return options;
+    }
+
+    bool skip(size_t size, Distribution distribution) const {
+        bool degenerate = distribution == Distribution::Sorted ||
+                          distribution == Distribution::NearlySorted;
+        return degenerate && size > this->max_degenerate;
+    }
+
+    bool selected(const std::string& name) const {
+        return this->filter.empty() || name.find(this->filter) != std::string::npos;
+    }
+
+ private:
+    static std::vector<unsigned> default_threads() {
+        unsigned all = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<unsigned> threads;
+        for (unsigned t = 1; t < all; t *= 2)
+            threads.push_back(t);
+        threads.push_back(all);
+        return threads;
+    }
+
+    static std::vector<std::string> split(const std::string& text) {
+        std::vector<std::string> items;
+        std::stringstream ss(text);
+        std::string item;
+        while (std::getline(ss, item, ','))
+            items.push_back(item);
+        return items;
+    }
+};
+
+/**
+ * Acumula resultados, mostrando uma linha legível por benchmark e, ao final,
+ * gravando todos em JSON se a opção --json tiver sido passada.
+ */
+class Runner {
+ public:
+    explicit Runner(const Options& options) : options(options) {}
+
+    ~Runner() {
+        this->write_json();
+    }
+
+    const Options& get_options() const {
+        return this->options;
+    }
+
+    /**
+     * Executa um benchmark várias vezes. A função de preparação roda fora da
+     * medição, e a função medida deve retornar quantas operações realizou.
+     */
+    Result& run(const std::string& name, Distribution distribution, size_t size,
+                const std::function<void()>& setup, const std::function<size_t()>& body,
+                const std::function<void()>& teardown = nullptr) {
+        Result result{name, bench::name(distribution), size, 0, {}, {}};
+        for (int i = 0; i < this->options.repetitions; ++i) {
+            if (setup)
+                setup();
+            clock::time_point start = clock::now();
+            size_t operations = body();
+            double elapsed = elapsed_ns(start);
+            if (teardown)
+                teardown();
+            result.operations = operations;
+            result.ns_per_op.push_back(elapsed / std::max<size_t>(operations, 1));
+        }
+        this->results.push_back(result);
+        this->print(this->results.back());
+        return this->results.back();
+    }
+
+    /// Adiciona um resultado medido manualmente.
+    Result& add(Result result) {
+        this->results.push_back(std::move(result));
+        this->print(this->results.back());
+        return this->results.back();
+    }
+
+ private:
+    Options options;
+    std::vector<Result> results;
+
+    void print(const Result& result) const {
+        // Com JSON na saída padrão, o texto legível vai para a saída de erro
+        std::ostream& os = this->options.json_path == "-" ? std::cerr : std::cout;
+        os << result.name << " [" << result.distribution << ", n=" << result.size << "]: "
+           << result.median() << " ns/op (min " << result.min() << ")";
+        for (const auto& field : result.extra)
+            os << ", " << field.first << "=" << field.second;
+        os << std::endl;
+    }
+
+    void write_json() const {
+        if (this->options.json_path.empty())
+            return;
+        std::ofstream file;
+        if (this->options.json_path != "-")
+            file.open(this->options.json_path);
+        std::ostream& os = this->options.json_path == "-" ? std::cout : file;
+        os << "[\n";
+        for (size_t i = 0; i < this->results.size(); ++i) {
+            const Result& result = this->results[i];
+            os << "  {\"name\": \"" << result.name << "\", \"distribution\": \""
+               << result.distribution << "\", \"size\": " << result.size
+               << ", \"operations\": " << result.operations
+               << ", \"ns_per_op_median\": " << result.median()
+               << ", \"ns_per_op_min\": " << result.min() << ", \"samples\": [";
+            for (size_t j = 0; j < result.ns_per_op.size(); ++j)
+                os << (j ? ", " : "") << result.ns_per_op[j];
+            os << "]";
+            for (const auto& field : result.extra)
+                os << ", \"" << field.first << "\": " << field.second;
+            os << "}" << (i + 1 < this->results.size() ? "," : "") << "\n";
+        }
+        os << "]" << std::endl;
+    }
+};
+
+/// Buffer de saída que descarta tudo, usado para medir funções que imprimem.
+class NullBuffer : public std::streambuf {
+ protected:
+    int overflow(int c) override {
+        return c;
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        return n;
+    }
+};
+
+/// Redireciona std::cout para um buffer nulo enquanto estiver no escopo.
+class SilenceCout {
+ public:
+    SilenceCout() : previous(std::cout.rdbuf(&this->null)) {}
+
+    ~SilenceCout() {
+        std::cout.rdbuf(this->previous);
+    }
+
+ private:
+    NullBuffer null;
+    std::streambuf* previous;
+};
+
+}  // namespace bench
+
+#endif  // BENCHMARKS_BENCH_HPP_
@@ -0,0 +1,194 @@
+#include "../BST.hpp"
+#include "../layout.hpp"
+#include "./bench.hpp"
+
+#include <memory>
+
+/*
+    Benchmarks das operações da árvore e do cálculo do layout, que rodam sem
+    abrir uma janela. Exemplo:
+        ./bst_bench --sizes=1000,100000 --dist=random,zipfian --json=bst.json
+*/
+
+using Tree = BST<int, int>;
+using NodePos = layout::NodePos<Tree::Node*>;
+
+static std::unique_ptr<Tree> build(const std::vector<int>& keys) {
+    std::unique_ptr<Tree> tree(new Tree());
+    for (int key : keys)
+        tree->insert(key, key);
+    return tree;
+}
+
+int main(int argc, char** argv) {
+    bench::Runner runner(bench::Options::parse(argc, argv));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            std::vector<int> keys = bench::make_keys(n, distribution);
+            std::vector<int> lookups = bench::make_lookups(keys, n, distribution);
+            std::unique_ptr<Tree> tree;
+
+            if (options.selected("bst.insert")) {
+                runner.run("bst.insert", distribution, n,
+                    [&] { tree.reset(new Tree()); },
+                    [&] {
+                        for (int key : keys)
+                            tree->insert(key, key);
+                        return keys.size();
+                    },
+                    [&] { tree.reset(); });
+            }
+
+            if (options.selected("bst.insert.auto_rebalance")) {
+                runner.run("bst.insert.auto_rebalance", distribution, n,
+                    [&] {
+                        tree.reset(new Tree());
+                        tree->set_rebalance_factor(2);
+                    },
+                    [&] {
+                        for (int key : keys)
+                            tree->insert(key, key);
+                        return keys.size();
+                    },
+                    [&] { tree.reset(); });
+            }
+
+            // Metade das inserções repete uma chave já inserida
+            std::vector<int> duplicated;
+            duplicated.reserve(keys.size() * 2);
+            for (size_t i = 0; i < keys.size(); ++i) {
+                duplicated.push_back(keys[i]);
+                duplicated.push_back(keys[(i * 2654435761u) % (i + 1)]);
+            }
+            if (options.selected("bst.insert.duplicates.throw")) {
+                runner.run("bst.insert.duplicates.throw", distribution, n,
+                    [&] { tree.reset(new Tree()); },
+                    [&] {
+                        for (int key : duplicated) {
+                            try {
+                                tree->insert(key, key);
+                            } catch (std::invalid_argument&) {
+                            }
+                        }
+                        return duplicated.size();
+                    },
+                    [&] { tree.reset(); });
+            }
+            if (options.selected("bst.insert.duplicates.try_insert")) {
+                runner.run("bst.insert.duplicates.try_insert", distribution, n,
+                    [&] { tree.reset(new Tree()); },
+                    [&] {
+                        for (int key : duplicated)
+                            tree->try_insert(key, key);
+                        return duplicated.size();
+                    },
+                    [&] { tree.reset(); });
+            }
+
+            if (options.selected("bst.rebalance")) {
+                runner.run("bst.rebalance", distribution, n,
+                    [&] { tree = build(keys); },
+                    [&] {
+                        tree->rebalance();
+                        return keys.size();
+                    },
+                    [&] { tree.reset(); });
+            }
+
+            tree = build(keys);
+            if (options.selected("bst.search")) {
+                runner.run("bst.search", distribution, n, nullptr, [&] {
+                    long sum = 0;
+                    for (int key : lookups)
+                        sum += tree->search(key);
+                    bench::do_not_optimize(sum);
+                    return lookups.size();
+                });
+            }
+
+            if (options.selected("bst.find")) {
+                runner.run("bst.find", distribution, n, nullptr, [&] {
+                    long sum = 0;
+                    for (int key : lookups)
+                        sum += tree->find(key)->m_value;
+                    bench::do_not_optimize(sum);
+                    return lookups.size();
+                });
+            }
+
+            if (options.selected("bst.stats.collect")) {
+                runner.run("bst.stats.collect", distribution, n, nullptr, [&] {
+                    bench::do_not_optimize(tree->collect_stats().average_depth);
+                    return keys.size();
+                });
+            }
+
+            // Tempo total de uma estimativa com 1000 amostras, não por nó
+            if (options.selected("bst.stats.sample")) {
+                runner.run("bst.stats.sample", distribution, n, nullptr, [&] {
+                    bench::do_not_optimize(tree->sample_stats(1000).average_depth);
+                    return 1;
+                });
+            }
+
+            if (options.selected("bst.inorder")) {
+                runner.run("bst.inorder", distribution, n, nullptr, [&] {
+                    bench::SilenceCout silence;
+                    tree->print_inorder();
+                    return keys.size();
+                });
+            }
+
+            if (options.selected("bst.breadth")) {
+                runner.run("bst.breadth", distribution, n, nullptr, [&] {
+                    bench::SilenceCout silence;
+                    tree->print_breadth();
+                    return keys.size();
+                });
+            }
+
+            if (options.selected("layout.breadth_first_search")) {
+                std::vector<NodePos> nodes;
+                std::vector<int> beginnings;
+                runner.run("layout.breadth_first_search", distribution, n,
+                    [&] {
+                        nodes.clear();
+                        beginnings.clear();
+                    },
+                    [&] {
+                        bench::do_not_optimize(layout::breadth_first_search(
+                            tree->get_root(), nodes, beginnings));
+                        return nodes.size();
+                    });
+            }
+
+            if (options.selected("layout.organize_data")) {
+                std::vector<NodePos> nodes;
+                std::vector<int> beginnings;
+                layout::breadth_first_search(tree->get_root(), nodes, beginnings);
+                float* vertices = nullptr;
+                runner.run("layout.organize_data", distribution, n, nullptr,
+                    [&] {
+                        vertices = layout::organize_data(0.01f, 0.01f, nodes, beginnings);
+                        return nodes.size();
+                    },
+                    [&] { delete[] vertices; });
+            }
+
+            if (options.selected("bst.destroy")) {
+                runner.run("bst.destroy", distribution, n,
+                    [&] { tree = build(keys); },
+                    [&] {
+                        tree.reset();
+                        return keys.size();
+                    });
+            }
+            tree.reset();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "../BST.hpp"
+#include "../compact_bst.hpp"
+#include "./bench.hpp"
+
+#include <malloc.h>
+
+#include <memory>
+
+/*
+    Compara a BST com nós alocados individualmente e a CompactBST, com e sem o
+    índice do pai: memória por chave (medida pelo malloc) e tempo de busca.
+        ./compact_bench --sizes=1000000 --dist=random,zipfian --json
+*/
+
+static size_t allocated_bytes() {
+    struct mallinfo2 info = mallinfo2();
+    // Blocos grandes, como o vetor da CompactBST, são alocados com mmap
+    return info.uordblks + info.hblkhd;
+}
+
+template<class Tree>
+static void measure(bench::Runner& runner, const std::string& name, bench::Distribution distribution,
+                    const std::vector<int>& keys, const std::vector<int>& lookups) {
+    size_t n = keys.size();
+    size_t before = allocated_bytes();
+    std::unique_ptr<Tree> tree(new Tree());
+    for (int key : keys)
+        tree->insert(key, key);
+    double bytes = static_cast<double>(allocated_bytes() - before) / n;
+
+    bench::Result& result = runner.run(name + ".search", distribution, n, nullptr, [&] {
+        long sum = 0;
+        for (int key : lookups)
+            sum += tree->search(key);
+        bench::do_not_optimize(sum);
+        return lookups.size();
+    });
+    result.extra.emplace_back("bytes_per_key", bytes);
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {10000, 1000000};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            std::vector<int> keys = bench::make_keys(n, distribution);
+            std::vector<int> lookups = bench::make_lookups(keys, n, distribution);
+            measure<BST<int, int>>(runner, "compact.pointer", distribution, keys, lookups);
+            measure<CompactBST<int, int>>(runner, "compact.index", distribution, keys, lookups);
+            measure<CompactBST<int, int, cmp::ThreeWay, compact::NoParent>>(runner, "compact.index_no_parent",
+                distribution, keys, lookups);
+        }
+    }
+    return 0;
+}
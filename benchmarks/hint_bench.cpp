@@ -0,0 +1,66 @@
+#include "../BST.hpp"
+#include "./bench.hpp"
+
+#include <memory>
+
+/*
+    Inserção com dica: uma sequência de n chaves novas, uma em cada intervalo
+    entre as chaves de uma árvore balanceada com n chaves, entra em ordem
+    crescente, quase crescente ou aleatória, com a busca partindo da raiz
+    (try_insert) ou da última chave inserida (inserter). Exemplo:
+        ./hint_bench --sizes=1000000 --dist=sorted,nearly_sorted,random --json
+*/
+
+using Tree = BST<int, int>;
+
+// Árvore balanceada com as chaves múltiplas de 4 em [0, 4n)
+static std::unique_ptr<Tree> make_base(size_t n) {
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i)
+        keys[i] = static_cast<int>(4 * i);
+    std::unique_ptr<Tree> tree(new Tree());
+    tree->build_sorted(keys.data(), keys.data(), n);
+    return tree;
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {100000, 1000000};
+    defaults.distributions = {bench::Distribution::Sorted, bench::Distribution::NearlySorted,
+                              bench::Distribution::Random};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            std::vector<int> keys = bench::make_keys(n, distribution);
+            for (int& key : keys)
+                key = 4 * key + 2;
+            std::unique_ptr<Tree> tree;
+
+            if (options.selected("hint.try_insert")) {
+                runner.run("hint.try_insert", distribution, n,
+                    [&] { tree = make_base(n); },
+                    [&] {
+                        for (int key : keys)
+                            tree->try_insert(key, key);
+                        return keys.size();
+                    },
+                    [&] { tree.reset(); });
+            }
+
+            if (options.selected("hint.inserter")) {
+                runner.run("hint.inserter", distribution, n,
+                    [&] { tree = make_base(n); },
+                    [&] {
+                        Tree::Inserter insert = tree->inserter();
+                        for (int key : keys)
+                            insert(key, key);
+                        return keys.size();
+                    },
+                    [&] { tree.reset(); });
+            }
+        }
+    }
+    return 0;
+}
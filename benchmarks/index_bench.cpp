@@ -0,0 +1,80 @@
+#include "../BST.hpp"
+#include "./bench.hpp"
+
+/*
+    Índice auxiliar da BST: inserção, busca de chaves presentes (search) e
+    de chaves ausentes (find, que não lança exceção), com e sem o índice, e
+    a memória do índice por chave. As chaves presentes são pares e as
+    ausentes, ímpares, então uma busca sem sucesso desce até uma folha.
+        ./index_bench --sizes=1000000 --dist=random,zipfian --json
+*/
+
+using Tree = BST<int, int>;
+
+static void measure(bench::Runner& runner, const std::string& name, bench::Distribution distribution,
+                    const std::vector<int>& keys, const std::vector<int>& hits,
+                    const std::vector<int>& misses, bool indexed) {
+    const bench::Options& options = runner.get_options();
+    size_t n = keys.size();
+    Tree tree;
+    auto fill = [&] {
+        tree.clear();
+        if (indexed)
+            tree.enable_index();
+        for (int key : keys)
+            tree.insert(key, key);
+        return n;
+    };
+
+    if (options.selected(name + ".insert"))
+        runner.run(name + ".insert", distribution, n, nullptr, fill);
+    else
+        fill();
+
+    if (options.selected(name + ".search_hit")) {
+        bench::Result& result = runner.run(name + ".search_hit", distribution, n, nullptr, [&] {
+            long sum = 0;
+            for (int key : hits)
+                sum += tree.search(key);
+            bench::do_not_optimize(sum);
+            return hits.size();
+        });
+        result.extra.emplace_back("index_bytes_per_key", static_cast<double>(tree.index_bytes()) / n);
+    }
+
+    if (options.selected(name + ".find_miss")) {
+        runner.run(name + ".find_miss", distribution, n, nullptr, [&] {
+            size_t found = 0;
+            for (int key : misses)
+                found += tree.find(key) != tree.end();
+            bench::do_not_optimize(found);
+            return misses.size();
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {100000, 1000000};
+    defaults.distributions = {bench::Distribution::Random, bench::Distribution::Zipfian};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            std::vector<int> keys = bench::make_keys(n, distribution);
+            std::vector<int> hits = bench::make_lookups(keys, n, distribution);
+            std::vector<int> misses(hits);
+            for (size_t i = 0; i < n; ++i) {
+                keys[i] *= 2;
+                hits[i] *= 2;
+                misses[i] = hits[i] + 1;
+            }
+            measure(runner, "bst", distribution, keys, hits, misses, false);
+            measure(runner, "bst.indexed", distribution, keys, hits, misses, true);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "../BST.hpp"
+#include "../layout.hpp"
+#include "./bench.hpp"
+
+#include <memory>
+
+/*
+    Compara o layout por contornos serial com o paralelo em diferentes
+    quantidades de threads, verificando que o resultado é idêntico, e mede o
+    layout com as subárvores recolhidas a partir da profundidade 10, que é o
+    que o primeiro frame da visualização calcula com set_collapse_depth(10).
+    Exemplo:
+        ./layout_bench --sizes=100000,1000000 --threads=1,2,4,8 --json
+*/
+
+using Tree = BST<int, int>;
+using NodePtr = Tree::Node*;
+using NodePos = layout::NodePos<NodePtr>;
+
+struct Output {
+    std::vector<NodePos> nodes;
+    std::vector<int> beginnings;
+    std::vector<float> vertices;
+    int max_distance;
+};
+
+static Output run_layout(NodePtr root, par::WorkStealingPool* pool) {
+    Output output;
+    output.max_distance = layout::contour_layout(root, output.nodes, output.beginnings, pool);
+    float* vertices = layout::organize_data(0.01f, 0.01f, output.nodes, output.beginnings, pool);
+    output.vertices.assign(vertices, vertices + output.nodes.size() * 4);
+    delete[] vertices;
+    return output;
+}
+
+static bool same(const Output& a, const Output& b) {
+    if (a.max_distance != b.max_distance || a.beginnings != b.beginnings ||
+        a.nodes.size() != b.nodes.size() || a.vertices != b.vertices)
+        return false;
+    for (size_t i = 0; i < a.nodes.size(); ++i) {
+        if (a.nodes[i].node != b.nodes[i].node || a.nodes[i].position != b.nodes[i].position ||
+            a.nodes[i].parent != b.nodes[i].parent)
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {100000, 1000000};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            Tree tree;
+            for (int key : bench::make_keys(n, distribution))
+                tree.insert(key, key);
+
+            Output reference = run_layout(tree.get_root(), nullptr);
+            double serial = runner.run("layout.contour.serial", distribution, n, nullptr, [&] {
+                Output output = run_layout(tree.get_root(), nullptr);
+                bench::do_not_optimize(output.max_distance);
+                return n;
+            }).median();
+
+            {
+                std::vector<NodePos> nodes;
+                std::vector<int> beginnings;
+                runner.run("layout.levels", distribution, n,
+                    [&] {
+                        nodes.clear();
+                        beginnings.clear();
+                    },
+                    [&] {
+                        bench::do_not_optimize(layout::breadth_first_search(
+                            tree.get_root(), nodes, beginnings));
+                        return n;
+                    });
+            }
+
+            if (options.selected("layout.collapsed")) {
+                layout::Frontier<NodePtr> frontier(10);
+                std::vector<NodePos> nodes;
+                std::vector<int> beginnings;
+                bench::Result& result = runner.run("layout.collapsed", distribution, n,
+                    [&] {
+                        nodes.clear();
+                        beginnings.clear();
+                    },
+                    [&] {
+                        layout::breadth_first_search(tree.get_root(), nodes, beginnings, &frontier);
+                        float* vertices = layout::organize_data(0.01f, 0.01f, nodes, beginnings);
+                        bench::do_not_optimize(vertices[0]);
+                        delete[] vertices;
+                        return 1;
+                    });
+                result.extra.emplace_back("visible", static_cast<double>(nodes.size()));
+            }
+
+            for (unsigned threads : options.threads) {
+                par::WorkStealingPool pool(threads);
+                if (!same(reference, run_layout(tree.get_root(), &pool))) {
+                    std::cerr << "Layout paralelo com " << threads
+                        << " threads difere do serial." << std::endl;
+                    return 1;
+                }
+                bench::Result& result = runner.run(
+                    "layout.contour.parallel." + std::to_string(threads), distribution, n,
+                    nullptr, [&] {
+                        Output output = run_layout(tree.get_root(), &pool);
+                        bench::do_not_optimize(output.max_distance);
+                        return n;
+                    });
+                result.extra.emplace_back("threads", threads);
+                result.extra.emplace_back("speedup", serial / result.median());
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "../BST.hpp"
+#include "./bench.hpp"
+
+#include <memory>
+
+/*
+    Ingestão em lote: lotes ordenados com 1/50 do tamanho da árvore (1 milhão
+    de chaves para os 50 milhões padrão) são adicionados a ela, um por
+    repetição, inserindo chave a chave ou montando uma árvore com o lote e
+    usando set_union. Cerca de um quarto das chaves de cada lote já existe e
+    só tem o valor atualizado. Antes, confere join com entradas
+    desbalanceadas. Exemplo:
+        ./merge_bench --sizes=50000000 --threads=1,8 --reps=5 --json
+*/
+
+using Tree = BST<int, int>;
+
+// Árvore balanceada com as chaves múltiplas de 4 em [0, 4n)
+static std::unique_ptr<Tree> make_base(size_t n) {
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i)
+        keys[i] = static_cast<int>(4 * i);
+    std::unique_ptr<Tree> tree(new Tree());
+    tree->build_sorted(keys.data(), keys.data(), n);
+    return tree;
+}
+
+static std::vector<int> make_batch(size_t n, size_t count, std::mt19937_64& gen) {
+    std::uniform_int_distribution<int> uniform(0, static_cast<int>(4 * n - 1));
+    std::vector<int> batch(count);
+    for (int& key : batch)
+        key = uniform(gen);
+    std::sort(batch.begin(), batch.end());
+    batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+    return batch;
+}
+
+/*
+    join com árvores degeneradas, inseridas em ordem crescente ou
+    decrescente: a borda descida pode acabar antes de a outra árvore caber,
+    e o resultado ainda deve ter todas as chaves em ordem.
+*/
+static bool verify_unbalanced_joins() {
+    for (int n = 1; n <= 40; ++n) {
+        for (int m = 1; m <= 40; ++m) {
+            for (int shape = 0; shape < 4; ++shape) {
+                Tree left, right;
+                for (int i = 0; i < n; ++i)
+                    left.insert(shape & 1 ? n - 1 - i : i, i);
+                for (int i = 0; i < m; ++i)
+                    right.insert(shape & 2 ? 1000 + m - 1 - i : 1000 + i, i);
+                Tree joined = Tree::join(std::move(left), 500, 0, std::move(right));
+                size_t count = 0;
+                int previous = -1;
+                for (const Tree::Node& node : joined) {
+                    if (node.m_key <= previous) {
+                        count = 0;
+                        break;
+                    }
+                    previous = node.m_key;
+                    ++count;
+                }
+                if (count != static_cast<size_t>(n + m + 1)) {
+                    std::cerr << "join falhou com " << n << " e " << m << " chaves." << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {50000000};
+    defaults.distributions = {bench::Distribution::Random};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+    if (!verify_unbalanced_joins())
+        return 1;
+
+    for (size_t n : options.sizes) {
+        size_t batch_size = std::max<size_t>(n / 50, 1);
+        std::unique_ptr<Tree> tree;
+        std::vector<int> batch;
+        std::mt19937_64 gen(42);
+
+        if (options.selected("merge.insert_each")) {
+            tree = make_base(n);
+            bench::Result& result = runner.run("merge.insert_each", bench::Distribution::Sorted, n,
+                [&] { batch = make_batch(n, batch_size, gen); },
+                [&] {
+                    for (int key : batch)
+                        tree->insert_or_assign(key, key);
+                    return batch.size();
+                });
+            result.extra.emplace_back("batch", batch_size);
+            tree.reset();
+        }
+
+        for (unsigned threads : options.threads) {
+            std::string name = "merge.union." + std::to_string(threads);
+            if (!options.selected(name))
+                continue;
+            par::WorkStealingPool pool(threads);
+            tree = make_base(n);
+            // O tempo inclui montar a árvore do lote, que chega ordenado
+            bench::Result& result = runner.run(name, bench::Distribution::Sorted, n,
+                [&] { batch = make_batch(n, batch_size, gen); },
+                [&] {
+                    Tree incoming;
+                    incoming.build_sorted(batch.data(), batch.data(), batch.size());
+                    tree->set_union(std::move(incoming), &pool);
+                    return batch.size();
+                });
+            result.extra.emplace_back("batch", batch_size);
+            result.extra.emplace_back("threads", threads);
+            tree.reset();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "../BST.hpp"
+#include "./bench.hpp"
+
+/*
+    Hashes de subárvore: custo da inserção com e sem merkle::Content e tempo
+    de um diff entre uma árvore e uma cópia com n / 1000 mudanças (metade
+    valores alterados, metade chaves novas), comparado a percorrer as duas
+    árvores em ordem. Os tempos de diff são por diff completo.
+        ./merkle_bench --sizes=1000000 --dist=random --json
+*/
+
+using Plain = BST<int, int>;
+using Hashed = BST<int, int, cmp::ThreeWay, adapt::None, merkle::Content>;
+
+template<class Tree>
+static void measure_insert(bench::Runner& runner, const std::string& name,
+                           bench::Distribution distribution, const std::vector<int>& keys) {
+    Tree tree;
+    runner.run(name, distribution, keys.size(), [&] { tree.clear(); }, [&] {
+        for (int key : keys)
+            tree.insert(key, key);
+        return keys.size();
+    });
+}
+
+// Diferenças encontradas ao percorrer as duas árvores inteiras em ordem
+static size_t traversal_diff(const Hashed& a, const Hashed& b) {
+    size_t changes = 0;
+    auto x = a.begin();
+    auto y = b.begin();
+    while (x != a.end() || y != b.end()) {
+        if (y == b.end() || (x != a.end() && x->m_key < y->m_key)) {
+            ++changes;
+            ++x;
+        } else if (x == a.end() || y->m_key < x->m_key) {
+            ++changes;
+            ++y;
+        } else {
+            changes += x->m_value != y->m_value;
+            ++x;
+            ++y;
+        }
+    }
+    return changes;
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {100000, 1000000};
+    defaults.distributions = {bench::Distribution::Random};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            // Chaves pares, para que as ímpares sejam chaves novas nas mudanças
+            std::vector<int> keys = bench::make_keys(n, distribution);
+            for (int& key : keys)
+                key *= 2;
+
+            if (options.selected("bst.insert"))
+                measure_insert<Plain>(runner, "bst.insert", distribution, keys);
+            if (options.selected("bst.hashed.insert"))
+                measure_insert<Hashed>(runner, "bst.hashed.insert", distribution, keys);
+
+            Hashed a;
+            for (int key : keys)
+                a.insert(key, key);
+            Hashed b(a);
+            size_t changes = std::max<size_t>(1, n / 1000);
+            std::vector<int> changed = bench::make_lookups(keys, changes, distribution);
+            for (size_t i = 0; i < changes; ++i) {
+                if (i % 2)
+                    b.insert_or_assign(changed[i], -changed[i]);
+                else
+                    b.try_insert(changed[i] + 1, 0);
+            }
+
+            if (options.selected("diff.merkle")) {
+                bench::Result& result = runner.run("diff.merkle", distribution, n, nullptr, [&] {
+                    merkle::Diff<Hashed::Node> diff = a.diff(b);
+                    bench::do_not_optimize(diff.added.size() + diff.changed.size());
+                    return 1;
+                });
+                merkle::Diff<Hashed::Node> diff = a.diff(b);
+                result.extra.emplace_back("changes",
+                    static_cast<double>(diff.added.size() + diff.removed.size() + diff.changed.size()));
+            }
+            if (options.selected("diff.traversal")) {
+                bench::Result& result = runner.run("diff.traversal", distribution, n, nullptr, [&] {
+                    bench::do_not_optimize(traversal_diff(a, b));
+                    return 1;
+                });
+                result.extra.emplace_back("changes", static_cast<double>(traversal_diff(a, b)));
+            }
+        }
+    }
+    return 0;
+}
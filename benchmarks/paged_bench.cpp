@@ -0,0 +1,106 @@
+#include "../BST.hpp"
+#include "../paged.hpp"
+#include "./bench.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+/*
+    PagedTree com um limite de memória residente de um quarto do arquivo, de
+    modo que o conjunto acessado é 4 vezes maior que o cache: buscas, varredura
+    em ordem e, para comparação, buscas sem limite e na BST em memória. Cada
+    resultado mostra as faltas no cache por operação e quanto do arquivo
+    ficou mapeado no processo. O arquivo é gravado no diretório atual e sai do
+    page cache ao ser aberto, então as faltas no cache são leituras do disco.
+    Exemplo:
+        ./paged_bench --sizes=4000000 --dist=random,zipfian --json
+*/
+
+using Tree = paged::PagedTree<int, int>;
+
+// Páginas de arquivos mapeadas no processo, em bytes (campo shared de /proc/self/statm)
+static double mapped_file_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t total = 0, resident = 0, shared = 0;
+    statm >> total >> resident >> shared;
+    return static_cast<double>(shared * paged::system_page_size());
+}
+
+template<class Body>
+static void measure(bench::Runner& runner, const std::string& name, bench::Distribution distribution,
+                    size_t n, const std::string& path, size_t resident_bytes, Body body) {
+    double before = mapped_file_bytes();
+    Tree tree(path, resident_bytes);
+    size_t misses = 0;
+    size_t operations = 0;
+    bench::Result& result = runner.run(name, distribution, n,
+        [&] { misses = tree.misses(); },
+        [&] {
+            operations = body(tree);
+            return operations;
+        });
+    result.extra.emplace_back("misses_per_op",
+        static_cast<double>(tree.misses() - misses) / std::max<size_t>(operations, 1));
+    result.extra.emplace_back("mapped_mb", (mapped_file_bytes() - before) / (1 << 20));
+    result.extra.emplace_back("limit_mb", static_cast<double>(resident_bytes) / (1 << 20));
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {1000000, 4000000};
+    defaults.distributions = {bench::Distribution::Random, bench::Distribution::Zipfian};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+    const std::string path = "paged_bench.tree";
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            std::vector<int> keys = bench::make_keys(n, distribution);
+            // Cada falta no cache é uma leitura do disco, então as buscas são limitadas
+            std::vector<int> lookups = bench::make_lookups(keys, std::min<size_t>(n, 100000), distribution);
+            std::sort(keys.begin(), keys.end());
+            paged::build(keys.data(), keys.data(), n, path);
+            size_t file_bytes;
+            {
+                Tree tree(path, 0);
+                file_bytes = tree.file_bytes();
+            }
+
+            auto find = [&lookups](Tree& tree) {
+                long sum = 0;
+                for (int key : lookups)
+                    sum += *tree.find(key);
+                bench::do_not_optimize(sum);
+                return lookups.size();
+            };
+            if (options.selected("paged.find"))
+                measure(runner, "paged.find", distribution, n, path, file_bytes / 4, find);
+            if (options.selected("paged.find_unbounded"))
+                measure(runner, "paged.find_unbounded", distribution, n, path, file_bytes, find);
+            if (options.selected("paged.scan")) {
+                measure(runner, "paged.scan", distribution, n, path, file_bytes / 4, [](Tree& tree) {
+                    long sum = 0;
+                    tree.for_each([&sum](int key, int value) { sum += key ^ value; });
+                    bench::do_not_optimize(sum);
+                    return tree.size();
+                });
+            }
+
+            if (options.selected("bst.find")) {
+                BST<int, int> bst;
+                bst.build_sorted(keys.data(), keys.data(), n);
+                runner.run("bst.find", distribution, n, nullptr, [&] {
+                    long sum = 0;
+                    for (int key : lookups)
+                        sum += bst.search(key);
+                    bench::do_not_optimize(sum);
+                    return lookups.size();
+                });
+            }
+            std::remove(path.c_str());
+        }
+    }
+    return 0;
+}
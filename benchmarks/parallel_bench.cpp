@@ -0,0 +1,95 @@
+#include "../BST.hpp"
+#include "./bench.hpp"
+
+#include <memory>
+
+/*
+    Escalabilidade das operações paralelas sobre subárvores (destruição, cópia,
+    for_each e reduce) de 1 thread até todas. Exemplo:
+        ./parallel_bench --sizes=10000000 --dist=random --threads=1,2,4,8 --json
+*/
+
+using Tree = BST<int, long>;
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {1000000, 10000000};
+    defaults.distributions = {bench::Distribution::Random};
+    defaults.repetitions = 3;
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            Tree base;
+            for (int key : bench::make_keys(n, distribution))
+                base.insert(key, key);
+            std::unique_ptr<Tree> tree;
+            auto sum = [](int, long value) { return value; };
+            auto add = [](long a, long b) { return a + b; };
+
+            double serial_destroy = runner.run("parallel.destroy.serial", distribution, n,
+                [&] { tree.reset(new Tree(base)); },
+                [&] {
+                    tree->clear();
+                    return n;
+                },
+                [&] { tree.reset(); }).median();
+            double serial_clone = runner.run("parallel.clone.serial", distribution, n, nullptr,
+                [&] {
+                    tree.reset(new Tree(base));
+                    return n;
+                },
+                [&] { tree.reset(); }).median();
+            double serial_reduce = runner.run("parallel.reduce.serial", distribution, n, nullptr,
+                [&] {
+                    bench::do_not_optimize(base.reduce(0L, sum, add));
+                    return n;
+                }).median();
+
+            for (unsigned threads : options.threads) {
+                par::WorkStealingPool pool(threads);
+                std::string suffix = "." + std::to_string(threads);
+
+                bench::Result* result = &runner.run("parallel.destroy" + suffix, distribution, n,
+                    [&] { tree.reset(new Tree(base)); },
+                    [&] {
+                        tree->clear(&pool);
+                        return n;
+                    },
+                    [&] { tree.reset(); });
+                result->extra.emplace_back("threads", threads);
+                result->extra.emplace_back("speedup", serial_destroy / result->median());
+
+                result = &runner.run("parallel.clone" + suffix, distribution, n, nullptr,
+                    [&] {
+                        tree.reset(new Tree(base.clone(pool)));
+                        return n;
+                    },
+                    [&] { tree.reset(); });
+                result->extra.emplace_back("threads", threads);
+                result->extra.emplace_back("speedup", serial_clone / result->median());
+
+                result = &runner.run("parallel.reduce" + suffix, distribution, n, nullptr, [&] {
+                    bench::do_not_optimize(base.reduce(0L, sum, add, &pool));
+                    return n;
+                });
+                result->extra.emplace_back("threads", threads);
+                result->extra.emplace_back("speedup", serial_reduce / result->median());
+
+                std::atomic<long> visited{0};
+                result = &runner.run("parallel.for_each" + suffix, distribution, n, nullptr, [&] {
+                    base.for_each([&visited](Tree::Node* node) {
+                        if (node->m_value & 1)
+                            visited.fetch_add(1, std::memory_order_relaxed);
+                    }, &pool);
+                    return n;
+                });
+                result->extra.emplace_back("threads", threads);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include "../BST.hpp"
+#include "../persistent.hpp"
+#include "./bench.hpp"
+
+#include <malloc.h>
+
+#include <deque>
+
+/*
+    Versões da PersistentBST: custo de uma versão nova comparado com a cópia
+    profunda da BST, custo das atualizações com as 16 últimas versões retidas,
+    tiradas a cada 1, 1000 ou nenhuma atualização, e memória por versão, que
+    corresponde aos caminhos copiados. Exemplo:
+        ./persistent_bench --sizes=1000000 --json
+*/
+
+using Tree = PersistentBST<int, int>;
+
+constexpr size_t retained = 16;
+
+static size_t allocated_bytes() {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {100000, 1000000};
+    defaults.distributions = {bench::Distribution::Random};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            std::vector<int> keys = bench::make_keys(n, distribution);
+            std::vector<int> updates = bench::make_lookups(keys, n, distribution);
+            Tree tree;
+            for (int key : keys)
+                tree.insert(key, key);
+
+            if (options.selected("persistent.snapshot")) {
+                runner.run("persistent.snapshot", distribution, n, nullptr, [&] {
+                    for (size_t i = 0; i < n; ++i) {
+                        Tree version = tree.snapshot();
+                        bench::do_not_optimize(version.get_root());
+                    }
+                    return n;
+                });
+            }
+
+            if (options.selected("bst.deep_copy")) {
+                BST<int, int> bst;
+                for (int key : keys)
+                    bst.insert(key, key);
+                runner.run("bst.deep_copy", distribution, n, nullptr, [&] {
+                    BST<int, int> copy(bst);
+                    bench::do_not_optimize(copy.get_root());
+                    return 1;
+                });
+            }
+
+            for (size_t every : {size_t(0), size_t(1000), size_t(1)}) {
+                std::string name = every ? "persistent.update.snapshot_every_" + std::to_string(every)
+                                         : "persistent.update";
+                if (!options.selected(name))
+                    continue;
+                std::deque<Tree> versions;
+                bench::Result& result = runner.run(name, distribution, n,
+                    [&] { versions.clear(); },
+                    [&] {
+                        for (size_t i = 0; i < updates.size(); ++i) {
+                            if (every && i % every == 0) {
+                                versions.push_back(tree.snapshot());
+                                if (versions.size() > retained)
+                                    versions.pop_front();
+                            }
+                            tree.insert_or_assign(updates[i], static_cast<int>(i));
+                        }
+                        return updates.size();
+                    });
+                if (!every)
+                    continue;
+                // Memória dos nós que só as versões retidas usam
+                versions.clear();
+                size_t before = allocated_bytes();
+                for (size_t i = 0; i < retained * every; ++i) {
+                    if (i % every == 0)
+                        versions.push_back(tree.snapshot());
+                    tree.insert_or_assign(updates[i % updates.size()], static_cast<int>(i));
+                }
+                result.extra.emplace_back("bytes_per_version",
+                    static_cast<double>(allocated_bytes() - before) / retained);
+            }
+        }
+    }
+    return 0;
+}
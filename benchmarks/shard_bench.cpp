@@ -0,0 +1,129 @@
+#include "../sharded_bst.hpp"
+#include "./bench.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/*
+    Ingestão de n chaves em lotes ordenados de n / 100 chaves, comparando uma
+    única BST protegida por um mutex com uma ShardedBST de uma árvore por
+    thread. Em *.insert, cada thread pega o próximo lote e insere chave a
+    chave; em *.batch, a BST única recebe cada lote com set_union sob o lock
+    e a floresta recebe os lotes por insert_batch, com as árvores em
+    paralelo. Os tempos são por chave. Exemplo:
+        ./shard_bench --sizes=10000000 --threads=1,2,4,8 --json
+*/
+
+using Tree = BST<int, int>;
+using Forest = ShardedBST<int, int>;
+
+// Lotes de chaves aleatórias, cada um ordenado e sem repetição
+static std::vector<std::vector<int>> make_batches(size_t n, bench::Distribution distribution) {
+    std::vector<int> keys = bench::make_keys(n, distribution);
+    size_t batch_size = std::max<size_t>(n / 100, 1);
+    std::vector<std::vector<int>> batches;
+    for (size_t begin = 0; begin < n; begin += batch_size) {
+        std::vector<int> batch(keys.begin() + begin, keys.begin() + std::min(n, begin + batch_size));
+        std::sort(batch.begin(), batch.end());
+        batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+        batches.push_back(std::move(batch));
+    }
+    return batches;
+}
+
+// Distribui os lotes entre as threads, cada uma pegando o próximo livre
+template<class F>
+static void ingest(unsigned threads, size_t count, F&& function) {
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&] {
+            for (size_t i = next++; i < count; i = next++)
+                function(i);
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {1000000, 10000000};
+    defaults.distributions = {bench::Distribution::Random};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            std::vector<std::vector<int>> batches = make_batches(n, distribution);
+            for (unsigned threads : options.threads) {
+                const std::string suffix = "." + std::to_string(threads);
+                std::unique_ptr<Tree> tree;
+                std::unique_ptr<Forest> forest;
+                std::mutex mutex;
+                auto reset = [&] {
+                    tree.reset(new Tree());
+                    forest.reset(new Forest(threads));
+                };
+
+                // Nos dois casos, um primeiro lote entra já balanceado, como numa
+                // árvore em uso; sem ele, o primeiro lote ordenado viraria uma lista
+                const std::vector<int>& first = batches[0];
+                if (options.selected("locked.insert" + suffix)) {
+                    auto prepare = [&] {
+                        reset();
+                        tree->build_sorted(first.data(), first.data(), first.size());
+                    };
+                    runner.run("locked.insert" + suffix, distribution, n, prepare, [&] {
+                        ingest(threads, batches.size(), [&](size_t i) {
+                            for (int key : batches[i]) {
+                                std::lock_guard<std::mutex> lock(mutex);
+                                tree->insert_or_assign(key, key);
+                            }
+                        });
+                        return n;
+                    }).extra.emplace_back("threads", threads);
+                }
+                if (options.selected("sharded.insert" + suffix)) {
+                    auto prepare = [&] {
+                        reset();
+                        forest->insert_batch(first.data(), first.data(), first.size());
+                    };
+                    runner.run("sharded.insert" + suffix, distribution, n, prepare, [&] {
+                        ingest(threads, batches.size(), [&](size_t i) {
+                            for (int key : batches[i])
+                                forest->insert_or_assign(key, key);
+                        });
+                        return n;
+                    }).extra.emplace_back("threads", threads);
+                }
+                if (options.selected("locked.batch" + suffix)) {
+                    runner.run("locked.batch" + suffix, distribution, n, reset, [&] {
+                        ingest(threads, batches.size(), [&](size_t i) {
+                            Tree incoming;
+                            incoming.build_sorted(batches[i].data(), batches[i].data(), batches[i].size());
+                            std::lock_guard<std::mutex> lock(mutex);
+                            tree->set_union(std::move(incoming));
+                        });
+                        return n;
+                    }).extra.emplace_back("threads", threads);
+                }
+                if (options.selected("sharded.batch" + suffix)) {
+                    par::WorkStealingPool pool(threads);
+                    bench::Result& result = runner.run("sharded.batch" + suffix, distribution, n, reset, [&] {
+                        for (const std::vector<int>& batch : batches)
+                            forest->insert_batch(batch.data(), batch.data(), batch.size(), &pool);
+                        return n;
+                    });
+                    result.extra.emplace_back("threads", threads);
+                    result.extra.emplace_back("skew", forest->skew());
+                }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "../BST.hpp"
+#include "../shm.hpp"
+#include "./bench.hpp"
+
+#include <unistd.h>
+
+/*
+    Publicação de snapshots em memória compartilhada: tempo de
+    Publisher::publish, que o processo da árvore pagaria a cada segundo, e,
+    do lado do viewer, da cópia consistente de uma versão (Subscriber::read)
+    e da cópia seguida da reconstrução da árvore (Subscriber::load). Os
+    tempos são por snapshot completo.
+        ./shm_bench --sizes=1000000 --dist=random --json
+*/
+
+using Tree = BST<int, int>;
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {100000, 1000000};
+    defaults.distributions = {bench::Distribution::Random};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    const std::string name = "/bst_bench_" + std::to_string(getpid());
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            Tree tree;
+            for (int key : bench::make_keys(n, distribution))
+                tree.insert(key, key);
+            shm::Publisher publisher(name, trace::encoded_size<Tree::Node>(n));
+            shm::Subscriber subscriber(name);
+
+            if (options.selected("shm.publish")) {
+                bench::Result& result = runner.run("shm.publish", distribution, n, nullptr, [&] {
+                    bench::do_not_optimize(publisher.publish(tree.get_root()));
+                    return 1;
+                });
+                result.extra.emplace_back("megabytes",
+                    trace::encoded_size<Tree::Node>(n) / (1024.0 * 1024.0));
+            }
+            publisher.publish(tree.get_root());
+            if (options.selected("shm.read")) {
+                std::string data;
+                runner.run("shm.read", distribution, n, nullptr, [&] {
+                    bench::do_not_optimize(subscriber.read(data));
+                    return 1;
+                });
+            }
+            if (options.selected("shm.load")) {
+                runner.run("shm.load", distribution, n, nullptr, [&] {
+                    Tree copy;
+                    bench::do_not_optimize(subscriber.load(copy));
+                    return 1;
+                });
+            }
+        }
+    }
+    return 0;
+}
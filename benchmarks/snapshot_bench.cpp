@@ -0,0 +1,196 @@
+#include "../snapshot.hpp"
+#include "./bench.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+
+/*
+    Compara o carregamento de snapshots binários com o caminho antigo, em que a
+    árvore era salva como texto e recarregada inserindo cada chave, depois de
+    conferir que entradas inválidas são rejeitadas. Exemplo:
+        ./snapshot_bench --sizes=10000000 --reps=1 --json
+*/
+
+using Tree = BST<int, int>;
+
+static const std::string text_path = "/tmp/bst_snapshot_bench.txt";
+static const std::string binary_path = "/tmp/bst_snapshot_bench.bin";
+static const std::string shaped_path = "/tmp/bst_snapshot_bench.shape.bin";
+static const std::string invalid_path = "/tmp/bst_snapshot_bench.invalid.bin";
+
+// Salva em pré-ordem, para que a reinserção reproduza a mesma árvore
+static void write_text(const Tree& tree, const std::string& path) {
+    std::ofstream os(path);
+    std::vector<Tree::Node*> stack{tree.get_root()};
+    while (!stack.empty()) {
+        Tree::Node* node = stack.back();
+        stack.pop_back();
+        os << node->m_key << ' ' << node->m_value << '\n';
+        if (node->m_right)
+            stack.push_back(node->m_right);
+        if (node->m_left)
+            stack.push_back(node->m_left);
+    }
+}
+
+// Confere que action lança std::runtime_error
+template<class F>
+static bool rejects(const char* name, F&& action) {
+    try {
+        action();
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    std::cerr << "Deveria falhar: " << name << "." << std::endl;
+    return false;
+}
+
+// Operações que devem falhar em vez de travar, ler fora do arquivo ou vazar nós
+static bool verify_rejections() {
+    bool ok = true;
+    Tree list;
+    for (int key : {4, 2, 6, 1, 3, 5, 7})
+        list.insert(key, key);
+    list.to_list();
+    ok &= rejects("write depois de to_list", [&] {
+        snapshot::write(list, invalid_path);
+    });
+    ok &= rejects("write em largura depois de to_list", [&] {
+        snapshot::write(list, invalid_path, snapshot::Order::LevelOrder);
+    });
+
+    // Cabeçalhos com seções fora do arquivo, sobrepostas, desalinhadas ou
+    // cujo tamanho transborda
+    Tree tree;
+    for (int key = 0; key < 100; ++key)
+        tree.insert(key * 7 % 100, key);
+    struct Corruption {
+        const char* name;
+        size_t field;
+        uint64_t value;
+    };
+    const Corruption corruptions[] = {
+        {"chaves fora do arquivo", offsetof(snapshot::Header, keys_offset), uint64_t(1) << 40},
+        {"chaves desalinhadas", offsetof(snapshot::Header, keys_offset), 65},
+        {"chaves sobre o cabeçalho", offsetof(snapshot::Header, keys_offset), 0},
+        {"valores sobre as chaves", offsetof(snapshot::Header, values_offset), 64},
+        {"estrutura sobre os valores", offsetof(snapshot::Header, structure_offset), 64},
+        {"contagem que transborda", offsetof(snapshot::Header, count), uint64_t(1) << 62},
+        {"contagem além do arquivo", offsetof(snapshot::Header, count), 1000},
+        {"ordem desconhecida", offsetof(snapshot::Header, order), 7},
+    };
+    for (const Corruption& corruption : corruptions) {
+        snapshot::write(tree, invalid_path, snapshot::Order::LevelOrder);
+        {
+            std::fstream file(invalid_path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(corruption.field);
+            if (corruption.field == offsetof(snapshot::Header, order)) {
+                uint32_t value = static_cast<uint32_t>(corruption.value);
+                file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+            } else {
+                file.write(reinterpret_cast<const char*>(&corruption.value), sizeof(corruption.value));
+            }
+        }
+        ok &= rejects(corruption.name, [] {
+            snapshot::MappedSnapshot<int, int> mapped(invalid_path);
+        });
+    }
+
+    // Carregar em uma árvore com chaves falha antes de criar os nós
+    snapshot::write(tree, invalid_path, snapshot::Order::InOrder, true);
+    {
+        snapshot::MappedSnapshot<int, int> mapped(invalid_path);
+        Tree target;
+        target.insert(1000, 0);
+        ok &= rejects("load_into em árvore não vazia", [&] {
+            mapped.load_into(target);
+        });
+    }
+    std::remove(invalid_path.c_str());
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {1000000, 10000000};
+    defaults.distributions = {bench::Distribution::Random};
+    defaults.repetitions = 3;
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+    if (!verify_rejections())
+        return 1;
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            std::vector<int> keys = bench::make_keys(n, distribution);
+            std::vector<int> lookups = bench::make_lookups(keys, n, distribution);
+            std::unique_ptr<Tree> tree(new Tree());
+            for (int key : keys)
+                tree->insert(key, key);
+
+            runner.run("snapshot.write.text", distribution, n, nullptr, [&] {
+                write_text(*tree, text_path);
+                return n;
+            });
+            runner.run("snapshot.write.binary", distribution, n, nullptr, [&] {
+                snapshot::write(*tree, binary_path);
+                return n;
+            });
+            snapshot::write(*tree, shaped_path, snapshot::Order::InOrder, true);
+            tree.reset();
+
+            runner.run("snapshot.load.text_reinsert", distribution, n,
+                [&] { tree.reset(new Tree()); },
+                [&] {
+                    std::ifstream is(text_path);
+                    int key, value;
+                    while (is >> key >> value)
+                        tree->insert(key, value);
+                    return n;
+                },
+                [&] { tree.reset(); });
+
+            runner.run("snapshot.load.mmap", distribution, n, nullptr, [&] {
+                snapshot::MappedSnapshot<int, int> mapped(binary_path);
+                bench::do_not_optimize(mapped.size());
+                return n;
+            });
+
+            runner.run("snapshot.load.balanced_build", distribution, n,
+                [&] { tree.reset(new Tree()); },
+                [&] {
+                    snapshot::MappedSnapshot<int, int> mapped(binary_path);
+                    mapped.load_into(*tree);
+                    return n;
+                },
+                [&] { tree.reset(); });
+
+            runner.run("snapshot.load.shaped_build", distribution, n,
+                [&] { tree.reset(new Tree()); },
+                [&] {
+                    snapshot::MappedSnapshot<int, int> mapped(shaped_path);
+                    mapped.load_into(*tree);
+                    return n;
+                },
+                [&] { tree.reset(); });
+
+            {
+                snapshot::MappedSnapshot<int, int> mapped(binary_path);
+                runner.run("snapshot.find.mmap", distribution, n, nullptr, [&] {
+                    long sum = 0;
+                    for (int key : lookups)
+                        sum += *mapped.find(key);
+                    bench::do_not_optimize(sum);
+                    return lookups.size();
+                });
+            }
+            std::remove(text_path.c_str());
+            std::remove(binary_path.c_str());
+            std::remove(shaped_path.c_str());
+        }
+    }
+    return 0;
+}
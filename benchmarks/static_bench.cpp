@@ -0,0 +1,74 @@
+#include "../BST.hpp"
+#include "../static_bst.hpp"
+#include "./bench.hpp"
+
+#include <algorithm>
+
+/*
+    Buscas em uma StaticBST montada na compilação, comparadas com uma BST das
+    mesmas chaves montada em tempo de execução e perfeitamente balanceada
+    (build_sorted). Os tamanhos são fixos na compilação, então --sizes só
+    escolhe entre 1024, 16384 e 65536.
+        ./static_bench --sizes=65536 --dist=random,zipfian --json
+*/
+
+// Chaves ordenadas e espalhadas por todo o intervalo de int, como numa tabela
+// escrita à mão; ordenar 65536 chaves passaria do limite do constexpr do GCC
+template<size_t N>
+constexpr std::array<int, N> fixed_keys() {
+    std::array<int, N> keys{};
+    for (size_t i = 0; i < N; ++i)
+        keys[i] = static_cast<int>(i * (INT32_MAX / N));
+    return keys;
+}
+
+template<size_t N>
+static void measure(bench::Runner& runner, bench::Distribution distribution) {
+    static constexpr std::array<int, N> keys = fixed_keys<N>();
+    static constexpr StaticBST<int, int, N> table(keys, keys);
+    std::vector<int> key_list(keys.begin(), keys.end());
+    std::vector<int> lookups = bench::make_lookups(key_list, std::max<size_t>(N, 1 << 20), distribution);
+
+    if (runner.get_options().selected("static.find")) {
+        runner.run("static.find", distribution, N, nullptr, [&] {
+            long sum = 0;
+            for (int key : lookups)
+                sum += *table.find(key);
+            bench::do_not_optimize(sum);
+            return lookups.size();
+        });
+    }
+    if (runner.get_options().selected("bst.find")) {
+        // As chaves estão ordenadas; inseri-las uma a uma daria uma lista
+        BST<int, int> tree;
+        tree.build_sorted(key_list.data(), key_list.data(), N);
+        runner.run("bst.find", distribution, N, nullptr, [&] {
+            long sum = 0;
+            for (int key : lookups)
+                sum += tree.search(key);
+            bench::do_not_optimize(sum);
+            return lookups.size();
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {1024, 16384, 65536};
+    defaults.distributions = {bench::Distribution::Random, bench::Distribution::Zipfian};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+    auto wanted = [&options](size_t n) {
+        return std::find(options.sizes.begin(), options.sizes.end(), n) != options.sizes.end();
+    };
+
+    for (bench::Distribution distribution : options.distributions) {
+        if (wanted(1024) && !options.skip(1024, distribution))
+            measure<1024>(runner, distribution);
+        if (wanted(16384) && !options.skip(16384, distribution))
+            measure<16384>(runner, distribution);
+        if (wanted(65536) && !options.skip(65536, distribution))
+            measure<65536>(runner, distribution);
+    }
+    return 0;
+}
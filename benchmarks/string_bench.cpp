@@ -0,0 +1,126 @@
+#include "../BST.hpp"
+#include "./bench.hpp"
+
+#include <map>
+#include <memory>
+
+/*
+    Árvores com chaves de texto parecidas com URLs, em dois formatos: com o
+    esquema ("https://www.kalobra.com/...") e com o domínio invertido
+    ("com.kalobra.www/..."), em que os primeiros bytes variam mais. Compara a
+    comparação antiga (<, > e ==), a de três vias, o cache de prefixo e o
+    std::map, além da busca com std::string_view sem criar temporários.
+        ./string_bench --sizes=100000,1000000 --dist=random,zipfian --json
+*/
+
+// Reproduz a busca antiga, com até três comparações completas por nível
+struct LegacyCompare {
+    int operator()(const std::string& a, const std::string& b) const {
+        if (a < b)
+            return -1;
+        if (a > b)
+            return 1;
+        return a == b ? 0 : 1;
+    }
+};
+
+static const char* const domains[] = {"com", "org", "net", "io", "br", "de", "edu", "gov"};
+static const char* const sections[] = {"products", "blog", "docs", "users", "search", "static"};
+
+static const char* const syllables[] = {"ka", "lo", "mi", "ne", "ru", "sa", "to", "vi",
+                                        "bra", "cel", "dor", "fen", "gal", "hum", "jor", "pel"};
+
+static std::string make_url(int key, bool reversed) {
+    unsigned hash = static_cast<unsigned>(key) * 2654435761u;
+    // Cerca de 4000 sites com nomes de 2 ou 3 sílabas
+    unsigned host = hash % 4096;
+    std::string site = std::string(syllables[host % 16]) + syllables[(host / 16) % 16];
+    if (host >= 256)
+        site += syllables[host / 256];
+    std::string domain = domains[(hash >> 13) % 8];
+    std::string path = "/" + std::string(sections[(hash >> 17) % 6]) + "/item-" + std::to_string(key);
+    if (reversed)
+        return domain + "." + site + ".www" + path;
+    return "https://www." + site + "." + domain + path;
+}
+
+template<class Tree>
+static void measure(bench::Runner& runner, const std::string& name, bench::Distribution distribution,
+                    const std::vector<std::string>& keys, const std::vector<std::string_view>& lookups) {
+    size_t n = keys.size();
+    std::unique_ptr<Tree> tree;
+    runner.run(name + ".insert", distribution, n,
+        [&] { tree.reset(new Tree()); },
+        [&] {
+            for (const std::string& key : keys)
+                tree->try_insert(key, 1);
+            return n;
+        });
+    runner.run(name + ".find", distribution, n, nullptr, [&] {
+        long sum = 0;
+        for (std::string_view key : lookups)
+            sum += tree->find(std::string(key))->m_value;
+        bench::do_not_optimize(sum);
+        return lookups.size();
+    });
+    if constexpr (cmp::is_transparent<typename Tree::key_compare>::value) {
+        runner.run(name + ".find_view", distribution, n, nullptr, [&] {
+            long sum = 0;
+            for (std::string_view key : lookups)
+                sum += tree->find(key)->m_value;
+            bench::do_not_optimize(sum);
+            return lookups.size();
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {100000, 1000000};
+    defaults.distributions = {bench::Distribution::Random, bench::Distribution::Zipfian};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            std::vector<int> ids = bench::make_keys(n, distribution);
+            std::vector<int> lookup_ids = bench::make_lookups(ids, n, distribution);
+            for (bool reversed : {false, true}) {
+                std::string format = reversed ? ".reversed" : ".scheme";
+                std::vector<std::string> keys;
+                std::vector<std::string> lookup_text;
+                for (int id : ids)
+                    keys.push_back(make_url(id, reversed));
+                for (int id : lookup_ids)
+                    lookup_text.push_back(make_url(id, reversed));
+                std::vector<std::string_view> lookups(lookup_text.begin(), lookup_text.end());
+
+                measure<BST<std::string, int, LegacyCompare>>(runner, "string.legacy" + format,
+                    distribution, keys, lookups);
+                measure<BST<std::string, int>>(runner, "string.three_way" + format,
+                    distribution, keys, lookups);
+                measure<BST<std::string, int, cmp::PrefixThreeWay>>(runner, "string.prefix" + format,
+                    distribution, keys, lookups);
+
+                std::unique_ptr<std::map<std::string, int, std::less<>>> map;
+                runner.run("string.std_map" + format + ".insert", distribution, n,
+                    [&] { map.reset(new std::map<std::string, int, std::less<>>()); },
+                    [&] {
+                        for (const std::string& key : keys)
+                            map->emplace(key, 1);
+                        return n;
+                    });
+                runner.run("string.std_map" + format + ".find_view", distribution, n, nullptr, [&] {
+                    long sum = 0;
+                    for (std::string_view key : lookups)
+                        sum += map->find(key)->second;
+                    bench::do_not_optimize(sum);
+                    return lookups.size();
+                });
+            }
+        }
+    }
+    return 0;
+}
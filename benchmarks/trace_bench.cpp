@@ -0,0 +1,162 @@
+#include "../BST.hpp"
+#include "./bench.hpp"
+
+#include <memory>
+#include <numeric>
+
+/*
+    Custo da gravação de eventos na inserção: sem gravador, com gravador
+    associado mas parado e gravando, com e sem checkpoints periódicos. Também
+    mede a reconstrução de estados a partir do trace, depois de conferir que
+    o replay reproduz os estados deixados pelas operações em lote. Exemplo:
+        ./trace_bench --sizes=1000000 --dist=random --json
+*/
+
+using Tree = BST<int, int>;
+
+/*
+    Grava inserções e remoções intercaladas com clear, build_sorted, adopt,
+    grow_doubles, set_union e split, e confere que o replay reconstrói o
+    estado depois de cada passo. Depois de to_list, o replay deve falhar em
+    vez de montar um estado errado.
+*/
+static bool verify_replay() {
+    trace::Recorder<int, int> recorder(1 << 12);
+    recorder.start();
+    Tree tree;
+    tree.set_tracer(&recorder);
+    // Só os últimos checkpoints ficam guardados, então cada estado é
+    // conferido assim que é alcançado
+    bool same = true;
+    auto check = [&] {
+        trace::Replayer<Tree> replayer(recorder);
+        Tree state;
+        replayer.state_at(recorder.sequence(), state);
+        if (trace::encode_tree(state.get_root()) != trace::encode_tree(tree.get_root())) {
+            std::cerr << "Replay difere no estado " << recorder.sequence() << "." << std::endl;
+            same = false;
+        }
+    };
+    auto insert_range = [&](int begin, int end) {
+        for (int key = begin; key < end; ++key)
+            tree.insert_or_assign(key * 7 % 101, key);
+        check();
+    };
+
+    insert_range(0, 50);
+    tree.clear();
+    check();
+    insert_range(50, 60);
+    tree.clear();
+    std::vector<int> keys(31);
+    std::iota(keys.begin(), keys.end(), 200);
+    tree.build_sorted(keys.data(), keys.data(), keys.size());
+    check();
+    tree.erase(215);
+    check();
+    Tree other;
+    other.insert(1000, 1);
+    other.insert(999, 2);
+    tree.clear();
+    tree.adopt(trace::decode_tree<Tree::Node>(trace::encode_tree(other.get_root())));
+    check();
+    tree.clear();
+    tree.grow_doubles(6);
+    check();
+    insert_range(100, 120);
+    Tree more;
+    more.insert(5000, 5000);
+    tree.set_union(std::move(more));
+    check();
+    Tree right = tree.split(30);
+    check();
+
+    if (!same)
+        return false;
+
+    tree.to_list();
+    trace::Replayer<Tree> after_list(recorder);
+    try {
+        Tree state;
+        after_list.state_at(recorder.sequence(), state);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    std::cerr << "Replay depois de to_list deveria falhar." << std::endl;
+    return false;
+}
+
+int main(int argc, char** argv) {
+    bench::Options defaults;
+    defaults.sizes = {100000, 1000000};
+    defaults.distributions = {bench::Distribution::Random};
+    bench::Runner runner(bench::Options::parse(argc, argv, defaults));
+    const bench::Options& options = runner.get_options();
+    if (!verify_replay())
+        return 1;
+
+    for (size_t n : options.sizes) {
+        for (bench::Distribution distribution : options.distributions) {
+            if (options.skip(n, distribution))
+                continue;
+            std::vector<int> keys = bench::make_keys(n, distribution);
+            std::unique_ptr<Tree> tree;
+            std::unique_ptr<trace::Recorder<int, int>> recorder;
+
+            auto insert_all = [&] {
+                for (int key : keys)
+                    tree->insert(key, key);
+                return n;
+            };
+            auto teardown = [&] {
+                tree.reset();
+                recorder.reset();
+            };
+
+            double off = runner.run("trace.insert.off", distribution, n,
+                [&] { tree.reset(new Tree()); }, insert_all, teardown).median();
+
+            struct Mode {
+                const char* name;
+                bool active;
+                uint64_t interval;
+            };
+            const Mode modes[] = {
+                {"trace.insert.idle", false, 0},
+                {"trace.insert.active", true, 0},
+                {"trace.insert.active_checkpoints", true, 1 << 20},
+            };
+            for (const Mode& mode : modes) {
+                bench::Result& result = runner.run(mode.name, distribution, n,
+                    [&] {
+                        tree.reset(new Tree());
+                        recorder.reset(new trace::Recorder<int, int>(1 << 16, mode.interval));
+                        if (mode.active)
+                            recorder->start();
+                        tree->set_tracer(recorder.get());
+                    },
+                    insert_all, teardown);
+                result.extra.emplace_back("overhead_ns",
+                    (result.median() - off) / static_cast<double>(n));
+            }
+
+            // Reconstrói o estado mais antigo ainda disponível no buffer
+            tree.reset(new Tree());
+            recorder.reset(new trace::Recorder<int, int>(1 << 16, 1 << 14));
+            recorder->start();
+            tree->set_tracer(recorder.get());
+            insert_all();
+            for (size_t i = 0; i < keys.size(); i += 2)
+                tree->erase(keys[i]);
+            trace::Replayer<Tree> replayer(*recorder);
+            runner.run("trace.replay.state", distribution, n, nullptr, [&] {
+                Tree state;
+                replayer.state_at(replayer.first() + (1 << 14) - 1, state);
+                bench::do_not_optimize(state.get_root());
+                return static_cast<size_t>(1 << 14);
+            });
+            teardown();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,252 @@
+#ifndef CAPTURE_HPP_
+#define CAPTURE_HPP_
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace vis {
+
+/**
+ * Grava os frames desenhados sem parar o pipeline a cada frame, como faria
+ * um glReadPixels direto para a memória. A leitura vai para um anel de pixel
+ * buffer objects: glReadPixels só agenda a cópia, e o frame é recolhido um
+ * ou dois frames depois, quando a cerca da cópia já foi sinalizada. Uma
+ * thread grava os frames recolhidos em um arquivo ou na entrada padrão de um
+ * processo, como um encoder.
+ *
+ * Se a GPU ainda não terminou a cópia mais antiga quando o anel está cheio,
+ * ou se a thread de escrita não acompanha, o frame não é gravado, em vez de
+ * atrasar a janela; dropped() conta esses frames.
+ */
+class FrameCapture {
+ public:
+    // Cópias pendentes na GPU e frames esperando pela thread de escrita
+    static constexpr uint ring_size = 3;
+    static constexpr uint queue_limit = 8;
+
+    FrameCapture() = default;
+
+    ~FrameCapture() {
+        this->stop();
+    }
+
+    FrameCapture(const FrameCapture&) = delete;
+
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    /**
+     * Começa a gravar frames de width x height pixels em RGBA, com as linhas
+     * de cima para baixo e sem cabeçalho. O tamanho não muda se a janela for
+     * redimensionada. Exige um contexto OpenGL atual.
+     *
+     * @param target Caminho do arquivo ou, começando com '|', um comando que
+     * recebe os frames pela entrada padrão, como
+     * "| ffmpeg -f rawvideo -pix_fmt rgba -s 1280x720 -r 60 -i - out.mp4".
+     */
+    void start(const std::string& target, uint width, uint height) {
+        this->stop();
+        if (!glfwGetCurrentContext() || !GLEW_ARB_pixel_buffer_object || !GLEW_ARB_sync)
+            throw std::runtime_error("Frame capture needs pixel buffer objects and sync objects.");
+        this->piped = !target.empty() && target[0] == '|';
+        // Se o encoder sair antes, a escrita falha em vez de encerrar o programa
+        if (this->piped)
+            std::signal(SIGPIPE, SIG_IGN);
+        this->output = this->piped ? popen(target.c_str() + 1, "w") : std::fopen(target.c_str(), "wb");
+        if (!this->output)
+            throw std::runtime_error("Não foi possível abrir " + target + ".");
+        this->width = width;
+        this->height = height;
+        this->bytes = static_cast<size_t>(width) * height * 4;
+        for (Slot& slot : this->ring) {
+            glGenBuffers(1, &slot.buffer);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, this->bytes, nullptr, GL_STREAM_READ);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        this->next = 0;
+        this->pending = 0;
+        this->stopping = false;
+        this->failed = false;
+        this->written_frames = 0;
+        this->dropped_frames = 0;
+        this->writer = std::thread([this] { this->write_frames(); });
+        this->active = true;
+    }
+
+    /// Espera as cópias pendentes, grava o que falta e fecha a saída.
+    void stop() {
+        if (!this->active)
+            return;
+        if (glfwGetCurrentContext()) {
+            while (this->pending > 0)
+                this->collect(true);
+            for (Slot& slot : this->ring)
+                glDeleteBuffers(1, &slot.buffer);
+        }
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+        this->ready.notify_one();
+        this->writer.join();
+        if (this->piped)
+            pclose(this->output);
+        else
+            std::fclose(this->output);
+        this->output = nullptr;
+        this->queue.clear();
+        this->spare.clear();
+        this->active = false;
+    }
+
+    bool is_active() const {
+        return this->active;
+    }
+
+    /**
+     * Agenda a cópia do back buffer e entrega à thread de escrita os frames
+     * cuja cópia já terminou. Deve ser chamada depois de desenhar e antes de
+     * glfwSwapBuffers.
+     */
+    void capture() {
+        if (!this->active)
+            return;
+        while (this->pending > 0 && this->collect(false))
+            continue;
+        if (this->pending == ring_size) {
+            ++this->dropped_frames;
+            return;
+        }
+        Slot& slot = this->ring[this->next];
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glReadPixels(0, 0, this->width, this->height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        this->next = (this->next + 1) % ring_size;
+        ++this->pending;
+    }
+
+    unsigned long written() const {
+        return this->written_frames;
+    }
+
+    unsigned long dropped() const {
+        return this->dropped_frames;
+    }
+
+ private:
+    struct Slot {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+    };
+
+    std::array<Slot, ring_size> ring;
+    // Próximo slot a receber uma cópia e quantos slots têm cópias pendentes
+    uint next = 0;
+    uint pending = 0;
+    uint width = 0;
+    uint height = 0;
+    size_t bytes = 0;
+    std::FILE* output = nullptr;
+    bool piped = false;
+    bool active = false;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::vector<unsigned char>> queue;
+    // Frames já gravados, reaproveitados para evitar alocações
+    std::vector<std::vector<unsigned char>> spare;
+    bool stopping = false;
+    std::atomic<bool> failed{false};
+    std::atomic<unsigned long> written_frames{0};
+    std::atomic<unsigned long> dropped_frames{0};
+
+    // Recolhe a cópia mais antiga. Sem wait, retorna falso se ela não terminou.
+    bool collect(bool wait) {
+        Slot& slot = this->ring[(this->next + ring_size - this->pending) % ring_size];
+        GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                         wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+            return false;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        --this->pending;
+
+        std::vector<unsigned char> frame;
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            if (this->queue.size() >= queue_limit || this->failed) {
+                ++this->dropped_frames;
+                return true;
+            }
+            if (!this->spare.empty()) {
+                frame = std::move(this->spare.back());
+                this->spare.pop_back();
+            }
+        }
+        frame.resize(this->bytes);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, this->bytes, GL_MAP_READ_BIT);
+        if (data) {
+            std::memcpy(frame.data(), data, this->bytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        if (!data) {
+            ++this->dropped_frames;
+            return true;
+        }
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->queue.push_back(std::move(frame));
+        }
+        this->ready.notify_one();
+        return true;
+    }
+
+    void write_frames() {
+        const size_t row = static_cast<size_t>(this->width) * 4;
+        while (true) {
+            std::vector<unsigned char> frame;
+            {
+                std::unique_lock<std::mutex> lock(this->mutex);
+                this->ready.wait(lock, [this] { return this->stopping || !this->queue.empty(); });
+                if (this->queue.empty())
+                    return;
+                frame = std::move(this->queue.front());
+                this->queue.pop_front();
+            }
+            // O OpenGL lê as linhas de baixo para cima
+            bool ok = !this->failed;
+            for (uint y = this->height; ok && y-- > 0;)
+                ok = std::fwrite(frame.data() + y * row, 1, row, this->output) == row;
+            if (ok) {
+                ++this->written_frames;
+            } else {
+                // O encoder pode ter saído; os próximos frames são descartados
+                this->failed = true;
+                ++this->dropped_frames;
+            }
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->spare.push_back(std::move(frame));
+        }
+    }
+};
+
+}  // namespace vis
+
+#endif  // CAPTURE_HPP_
@@ -0,0 +1,332 @@
+#ifndef COMPACT_BST_HPP_
+#define COMPACT_BST_HPP_
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "./compare.hpp"
+
+/*
+    Variante da BST em que os nós ficam em um único vetor e se ligam por
+    índices de 32 bits em vez de ponteiros. Para BST<int, int>, cada nó ocupa
+    40 bytes mais o cabeçalho do malloc; aqui são 24 bytes com o índice do pai
+    ou 20 sem ele, todos contíguos na memória. As chaves são comparadas como
+    na BST, com um comparador de três vias (ver compare.hpp).
+*/
+
+namespace compact {
+
+/// Políticas que definem se os nós guardam o índice do pai.
+struct WithParent {
+    static constexpr bool enabled = true;
+};
+
+struct NoParent {
+    static constexpr bool enabled = false;
+};
+
+template<bool enabled>
+struct ParentField {
+    uint32_t m_parent;
+};
+
+template<>
+struct ParentField<false> {};
+
+}  // namespace compact
+
+template<class K, class V, class Compare = cmp::ThreeWay, class Links = compact::WithParent>
+class CompactBST {
+ public:
+    using key_type = K;
+    using mapped_type = V;
+    using key_compare = Compare;
+
+    static constexpr uint32_t null = UINT32_MAX;
+    static constexpr bool has_prefix = cmp::has_prefix<Compare>::value;
+
+    struct Node : compact::ParentField<Links::enabled>, cmp::PrefixField<has_prefix> {
+        uint32_t m_left;
+        uint32_t m_right;
+        uint32_t size;
+        K m_key;
+        V m_value;
+    };
+
+    /**
+     * Referência a um nó que se comporta como ponteiro, com os métodos que a
+     * Visualization usa. Deixa de ser válida quando a árvore é alterada.
+     */
+    class NodeRef {
+     public:
+        NodeRef(const CompactBST* tree = nullptr, uint32_t index = null)
+            : tree(tree), index(index) {}
+
+        const NodeRef* operator->() const {
+            return this;
+        }
+
+        explicit operator bool() const {
+            return this->index != null;
+        }
+
+        bool operator==(const NodeRef& other) const {
+            return this->index == other.index && this->tree == other.tree;
+        }
+
+        bool operator!=(const NodeRef& other) const {
+            return !(*this == other);
+        }
+
+        // Visualização:
+        NodeRef left() const {
+            return NodeRef(this->tree, this->node().m_left);
+        }
+
+        NodeRef right() const {
+            return NodeRef(this->tree, this->node().m_right);
+        }
+
+        NodeRef parent() const {
+            static_assert(Links::enabled, "Parent links are disabled for this tree.");
+            return NodeRef(this->tree, this->node().m_parent);
+        }
+
+        K key() const {
+            return this->node().m_key;
+        }
+
+        V value() const {
+            return this->node().m_value;
+        }
+
+        uint32_t get_index() const {
+            return this->index;
+        }
+
+     private:
+        const CompactBST* tree;
+        uint32_t index;
+
+        const Node& node() const {
+            return this->tree->nodes[this->index];
+        }
+    };
+
+    explicit CompactBST(Compare compare = Compare()) : compare(compare) {
+        this->root = null;
+    }
+
+    /// Reserva espaço para count nós, evitando realocações durante as inserções.
+    void reserve(size_t count) {
+        this->nodes.reserve(count);
+    }
+
+    size_t size() const {
+        return this->nodes.size();
+    }
+
+    /// Memória ocupada pelos nós, incluindo a capacidade reservada.
+    size_t memory_bytes() const {
+        return sizeof(*this) + this->nodes.capacity() * sizeof(Node);
+    }
+
+    NodeRef get_root() const {
+        return NodeRef(this, this->root);
+    }
+
+    void clear() {
+        this->nodes.clear();
+        this->root = null;
+    }
+
+    void insert(const K key, const V value) {
+        if (this->nodes.size() >= null) {
+            throw std::length_error("Too many nodes for 32-bit links.");
+        }
+        const auto prefix = probe(key);
+        uint32_t parent = null;
+        uint32_t* link = &this->root;
+        while (*link != null) {
+            parent = *link;
+            int order = this->compare_to(prefix, key, this->nodes[parent]);
+            if (order < 0) {
+                link = &this->nodes[parent].m_left;
+            } else if (order > 0) {
+                link = &this->nodes[parent].m_right;
+            } else {
+                throw std::invalid_argument("Can't insert duplicated key" +
+                    cmp::describe(key) + ".");
+            }
+        }
+        // A chave é nova, então todos os nós do caminho ganham um descendente
+        for (uint32_t index = this->root; index != null;) {
+            Node& node = this->nodes[index];
+            ++node.size;
+            index = this->compare_to(prefix, key, node) < 0 ? node.m_left : node.m_right;
+        }
+        uint32_t index = static_cast<uint32_t>(this->nodes.size());
+        *link = index;
+        Node node;
+        node.m_left = null;
+        node.m_right = null;
+        node.size = 1;
+        node.m_key = key;
+        node.m_value = value;
+        if constexpr (has_prefix) {
+            node.m_prefix = prefix;
+        }
+        this->set_parent(node, parent);
+        // Feito por último, pois pode realocar o vetor apontado por link
+        this->nodes.push_back(node);
+    }
+
+    V& search(const K& key) {
+        V* value = this->find(key);
+        if (!value) {
+            throw std::invalid_argument("Key" + cmp::describe(key) + " not found.");
+        }
+        return *value;
+    }
+
+    /// Retorna o valor associado à chave ou nullptr se ela não existir.
+    V* find(const K& key) {
+        const auto prefix = probe(key);
+        uint32_t index = this->root;
+        while (index != null) {
+            Node& node = this->nodes[index];
+            int order = this->compare_to(prefix, key, node);
+            if (order == 0) {
+                return &node.m_value;
+            }
+            index = order < 0 ? node.m_left : node.m_right;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Remove a chave, se existir. O último nó do vetor é movido para a posição
+     * liberada, mantendo o armazenamento contíguo.
+     */
+    bool erase(const K& key) {
+        const auto prefix = probe(key);
+        this->path.clear();
+        uint32_t index = this->root;
+        while (index != null) {
+            int order = this->compare_to(prefix, key, this->nodes[index]);
+            if (order == 0) {
+                break;
+            }
+            this->path.push_back(index);
+            index = order < 0 ? this->nodes[index].m_left : this->nodes[index].m_right;
+        }
+        if (index == null) {
+            return false;
+        }
+        uint32_t removed = index;
+        // Com dois filhos, o sucessor ocupa o lugar do nó e é removido no lugar dele
+        if (this->nodes[index].m_left != null && this->nodes[index].m_right != null) {
+            this->path.push_back(index);
+            removed = this->nodes[index].m_right;
+            while (this->nodes[removed].m_left != null) {
+                this->path.push_back(removed);
+                removed = this->nodes[removed].m_left;
+            }
+            this->nodes[index].m_key = this->nodes[removed].m_key;
+            this->nodes[index].m_value = this->nodes[removed].m_value;
+            if constexpr (has_prefix) {
+                this->nodes[index].m_prefix = this->nodes[removed].m_prefix;
+            }
+        }
+        for (uint32_t ancestor : this->path) {
+            --this->nodes[ancestor].size;
+        }
+        const Node& node = this->nodes[removed];
+        uint32_t child = node.m_left != null ? node.m_left : node.m_right;
+        uint32_t parent = this->path.empty() ? null : this->path.back();
+        this->link_of(parent, removed) = child;
+        if (child != null) {
+            this->set_parent(this->nodes[child], parent);
+        }
+        this->move_last(removed);
+        return true;
+    }
+
+ private:
+    std::vector<Node> nodes;
+    uint32_t root;
+    std::vector<uint32_t> path;
+    Compare compare;
+
+    // Prefixo da chave buscada, calculado uma vez por busca
+    template<class KeyLike>
+    static auto probe(const KeyLike& key) {
+        if constexpr (has_prefix) {
+            return Compare::prefix(key);
+        } else {
+            return 0;
+        }
+    }
+
+    template<class Probe, class KeyLike>
+    int compare_to(const Probe& probe, const KeyLike& key, const Node& node) const {
+        if constexpr (has_prefix) {
+            if (probe != node.m_prefix) {
+                return probe < node.m_prefix ? -1 : 1;
+            }
+        }
+        return this->compare(key, node.m_key);
+    }
+
+    static void set_parent(Node& node, uint32_t parent) {
+        if constexpr (Links::enabled) {
+            node.m_parent = parent;
+        }
+    }
+
+    // Campo que aponta para child: a raiz ou um dos filhos de parent
+    uint32_t& link_of(uint32_t parent, uint32_t child) {
+        if (parent == null) {
+            return this->root;
+        }
+        Node& node = this->nodes[parent];
+        return node.m_left == child ? node.m_left : node.m_right;
+    }
+
+    uint32_t parent_of(uint32_t index) const {
+        if constexpr (Links::enabled) {
+            return this->nodes[index].m_parent;
+        } else {
+            // Sem o índice do pai, ele é encontrado buscando a chave desde a raiz
+            const Node& node = this->nodes[index];
+            auto prefix = probe(node.m_key);
+            uint32_t parent = null;
+            uint32_t current = this->root;
+            while (current != index) {
+                parent = current;
+                current = this->compare_to(prefix, node.m_key, this->nodes[current]) < 0
+                    ? this->nodes[current].m_left : this->nodes[current].m_right;
+            }
+            return parent;
+        }
+    }
+
+    // Move o último nó do vetor para a posição free, já desligada da árvore
+    void move_last(uint32_t free) {
+        uint32_t last = static_cast<uint32_t>(this->nodes.size() - 1);
+        if (free != last) {
+            this->link_of(this->parent_of(last), last) = free;
+            this->nodes[free] = this->nodes[last];
+            for (uint32_t child : {this->nodes[free].m_left, this->nodes[free].m_right}) {
+                if (child != null) {
+                    this->set_parent(this->nodes[child], free);
+                }
+            }
+        }
+        this->nodes.pop_back();
+    }
+};
+
+#endif  // COMPACT_BST_HPP_
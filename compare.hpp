@@ -0,0 +1,108 @@
+#ifndef COMPARE_HPP_
+#define COMPARE_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/*
+    Comparadores de chaves da BST. Cada um retorna um único resultado de três
+    vias (negativo, zero ou positivo), então cada nível da busca faz uma
+    comparação em vez de até três com <, > e ==.
+*/
+
+namespace cmp {
+
+template<class T>
+constexpr bool is_string_like = std::is_convertible<const T&, std::string_view>::value;
+
+/**
+ * Comparador padrão: aritméticos sem desvios, textos com uma única passada
+ * (std::string_view::compare) e os demais tipos com operator<. É transparente,
+ * então std::string_view ou const char* buscam em chaves std::string sem criar
+ * temporários.
+ */
+struct ThreeWay {
+    using is_transparent = void;
+
+    template<class A, class B>
+    int operator()(const A& a, const B& b) const {
+        if constexpr (is_string_like<A> && is_string_like<B>) {
+            return std::string_view(a).compare(std::string_view(b));
+        } else if constexpr (std::is_arithmetic<A>::value && std::is_arithmetic<B>::value) {
+            return (b < a) - (a < b);
+        } else {
+            return a < b ? -1 : (b < a ? 1 : 0);
+        }
+    }
+};
+
+/**
+ * Comparador para chaves de texto que guarda em cada nó os 8 primeiros bytes
+ * da chave como um inteiro big endian, cuja ordem é a mesma do texto. Quando
+ * os prefixos diferem, a comparação é decidida sem acessar o texto, que em
+ * std::string longas fica em outra região da memória.
+ */
+struct PrefixThreeWay : ThreeWay {
+    using prefix_type = uint64_t;
+
+    template<class T>
+    static uint64_t prefix(const T& key) {
+        static_assert(is_string_like<T>, "PrefixThreeWay requires text keys.");
+        std::string_view text(key);
+        unsigned char bytes[8] = {};
+        std::memcpy(bytes, text.data(), text.size() < 8 ? text.size() : 8);
+        uint64_t result = 0;
+        for (unsigned char byte : bytes)
+            result = (result << 8) | byte;
+        return result;
+    }
+};
+
+template<class Compare, class = void>
+struct has_prefix : std::false_type {};
+
+template<class Compare>
+struct has_prefix<Compare, std::void_t<typename Compare::prefix_type>> : std::true_type {};
+
+template<class Compare, class = void>
+struct is_transparent : std::false_type {};
+
+template<class Compare>
+struct is_transparent<Compare, std::void_t<typename Compare::is_transparent>> : std::true_type {};
+
+template<class T, class = void>
+struct printable : std::false_type {};
+
+template<class T>
+struct printable<T, std::void_t<decltype(std::declval<std::ostream&>() << std::declval<const T&>())>>
+    : std::true_type {};
+
+/// Chave formatada para mensagens de erro, precedida de espaço, ou "" se ela não puder ser impressa.
+template<class KeyLike>
+std::string describe(const KeyLike& key) {
+    if constexpr (printable<KeyLike>::value) {
+        std::ostringstream stream;
+        stream << ' ' << key;
+        return stream.str();
+    } else {
+        return "";
+    }
+}
+
+/// Campo opcional dos nós com o prefixo da chave.
+template<bool enabled>
+struct PrefixField {
+    uint64_t m_prefix;
+};
+
+template<>
+struct PrefixField<false> {};
+
+}  // namespace cmp
+
+#endif  // COMPARE_HPP_
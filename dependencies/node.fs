@@ -2,10 +2,21 @@
 
 precision mediump float;
 
+in vec2 local;
+
 out vec4 color;
 
 uniform vec4 rgba;
+uniform vec4 border;
+
+// Largura da borda em pixels
+const float border_width = 1.5;
 
 void main() {
-    color = rgba;
-}
\ No newline at end of file
+    // Distância ao centro e tamanho de um pixel, ambos em raios
+    float d = length(local);
+    float pixel = fwidth(d);
+    float inside = 1.0 - smoothstep(1.0 - pixel, 1.0, d);
+    float edge = smoothstep(1.0 - (border_width + 1.0) * pixel, 1.0 - border_width * pixel, d);
+    color = vec4(mix(rgba.rgb, border.rgb, edge), inside);
+}
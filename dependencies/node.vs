@@ -1,11 +1,20 @@
 #version 300 es
 
-precision mediump float;
+precision highp float;
 
-layout (location = 0) in vec2 position;
+layout (location = 0) in vec2 corner;
+layout (location = 1) in vec2 center;
 
 uniform mat4 transform;
+uniform vec2 radius;
+
+// Posição no quadrado do nó, em raios a partir do centro
+out vec2 local;
+
+// O quadrado é um pouco maior que o círculo para caber a suavização da borda
+const float margin = 1.1;
 
 void main() {
-    gl_Position = transform * vec4(position, 0.0, 1.0);
-}
\ No newline at end of file
+    local = corner * margin;
+    gl_Position = transform * vec4(center + local * radius, 0.0, 1.0);
+}
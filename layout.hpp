@@ -0,0 +1,507 @@
+#ifndef LAYOUT_HPP_
+#define LAYOUT_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <functional>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "./parallel.hpp"
+
+/// Cálculo das posições dos nós na tela, separado da visualização para que
+/// possa ser usado (e medido) sem uma janela ou contexto OpenGL.
+namespace layout {
+
+// Estrutura usada para armazenar o ponteiro a um nó e sua posição na tela
+template<typename NodePtr>
+struct NodePos {
+    NodePtr node;
+    // Posição do nó relativa ao centro do tela
+    int position;
+    // Índice do nó pai no vetor de nós
+    int parent;
+    // Índice do nó filho esquerdo no vetor de nós
+    int left_index = 0;
+    // Índice do nó filho direito no vetor de nós
+    int right_index = 0;
+    // Nó com filhos fora do layout, desenhado no lugar da subárvore inteira
+    bool collapsed = false;
+};
+
+// Nós podem ir para um unordered_set se o tipo do nó tiver std::hash
+template<class T, class = void>
+struct is_hashable : std::false_type {};
+
+template<class T>
+struct is_hashable<T, std::void_t<decltype(std::hash<T>()(std::declval<const T&>()))>>
+    : std::true_type {};
+
+/**
+ * Define quais subárvores entram no layout. A partir da profundidade dada,
+ * os nós começam recolhidos, e toggle inverte o estado de um nó qualquer.
+ * Os layouts não descem abaixo de um nó recolhido, então o custo é
+ * proporcional à quantidade de nós visíveis, não ao tamanho da árvore.
+ */
+template<typename NodePtr>
+class Frontier {
+ public:
+    /// Profundidade negativa deixa a árvore inteira expandida.
+    explicit Frontier(int depth = -1) : depth(depth) {}
+
+    int get_depth() const {
+        return this->depth;
+    }
+
+    /// Muda a profundidade e descarta os nós alternados individualmente.
+    void set_depth(int depth) {
+        this->depth = depth;
+        this->toggled.clear();
+    }
+
+    bool is_collapsed(NodePtr node, int depth) const {
+        bool by_depth = this->depth >= 0 && depth >= this->depth;
+        return by_depth != this->contains(node);
+    }
+
+    void toggle(NodePtr node) {
+        if constexpr (is_hashable<NodePtr>::value) {
+            if (!this->toggled.erase(node))
+                this->toggled.insert(node);
+        } else {
+            auto it = std::find(this->toggled.begin(), this->toggled.end(), node);
+            if (it != this->toggled.end())
+                this->toggled.erase(it);
+            else
+                this->toggled.push_back(node);
+        }
+    }
+
+    void clear() {
+        this->toggled.clear();
+    }
+
+ private:
+    int depth;
+    // Nós cujo estado é o oposto do definido pela profundidade. Referências
+    // como CompactBST::NodeRef só têm ==, mas o usuário alterna poucos nós.
+    std::conditional_t<is_hashable<NodePtr>::value, std::unordered_set<NodePtr>,
+                       std::vector<NodePtr>> toggled;
+
+    bool contains(NodePtr node) const {
+        if constexpr (is_hashable<NodePtr>::value)
+            return this->toggled.count(node) != 0;
+        else
+            return std::find(this->toggled.begin(), this->toggled.end(), node) != this->toggled.end();
+    }
+};
+
+// Diz se os filhos do nó entram no layout, marcando como recolhido o nó que
+// tem filhos escondidos
+template<typename NodePtr>
+bool expanded(NodePos<NodePtr>& pos, int depth, const Frontier<NodePtr>* frontier) {
+    if (!frontier || !frontier->is_collapsed(pos.node, depth))
+        return true;
+    pos.collapsed = static_cast<bool>(pos.node->left()) || static_cast<bool>(pos.node->right());
+    return !pos.collapsed;
+}
+
+// Encontra todos os nós de cada nível (altura) diferente da árvore e o
+// o primeiro índice de cada nível da árvore. Armazena ponteiros para esses
+// nós nos vetores dados como argumentos e retorna a maior distância entre
+// qualquer nó e a origem, para evitar que seu tamanho exceda o máximo que
+// a tela pode comportar. Também calcula as posições dos nós na exibição.
+// Com uma fronteira, os filhos dos nós recolhidos não são visitados.
+template<typename NodePtr>
+int breadth_first_search(NodePtr root, std::vector<NodePos<NodePtr>>& nodes,
+                         std::vector<int>& beginnings,
+                         const Frontier<NodePtr>* frontier = nullptr) {
+    nodes.push_back(NodePos<NodePtr>{root, 0, 0});
+    beginnings.push_back(0);
+    int index = 0, previous_queue_size = 0, max_distance_from_origin = 0;
+    while (index < nodes.size()) {
+        // Encontra índice inicial de cada nível (altura) da árvore
+        if (index == previous_queue_size) {
+            previous_queue_size = nodes.size();
+            beginnings.push_back(previous_queue_size);
+        }
+        bool open = expanded(nodes[index], static_cast<int>(beginnings.size()) - 2, frontier);
+        if (open && nodes[index].node->left()) {
+            nodes[index].left_index = nodes.size();
+            nodes.push_back(NodePos<NodePtr>{nodes[index].node->left(),
+                nodes[index].position - 1, index});
+
+            // Se o último nó adicionado colide com o penúltimo, move alguns nós
+            if (nodes[nodes.size() - 2].position == nodes.back().position) {
+                bool should_move = false;
+                // Avança o último nó para a direita
+                ++nodes.back().position;
+                // Recua todos os outros nós do mesmo nível para a esquerda
+                for (int i = nodes.size() - 2; i >= beginnings.back(); --i)
+                    --nodes[i].position;
+                
+                int current_level = beginnings.size() - 1;
+                int child = nodes.size() - 1;
+                int parent = nodes[child].parent;
+                // Se o pai tem o nó atual como filho esquerdo, atualiza sua posição e dos antecessores
+                do {
+                    // Não move a raiz, assim ela sempre fica no centro da tela
+                    if (parent == 0)
+                        break;
+                    should_move = false;
+                    // Avança o pai do nó atual e todos à sua direita
+                    for (int i = parent; i < beginnings[current_level]; ++i) {
+                        ++nodes[i].position;
+                        // Se nós foram movidos neste nível, garante que o nível acima sofrerá
+                        // mudanças mesmo que o pai do nó atual tenha ele como filho direito
+                        should_move = true;
+                    }
+                    child = parent;
+                    parent = nodes[child].parent;
+                    --current_level;
+                } while (true);
+
+                current_level = beginnings.size() - 2;
+                child = nodes.size() - 2;
+                parent = nodes[child].parent;
+                // Se o pai tem o nó deslocado para a esquerda como filho direito, atualiza posições
+                do {
+                    if (parent == 0)
+                        break;
+                    should_move = false;
+                    // Recua todos os nós à esquerda do pai do nó afetado
+                    for (int i = parent; i >= beginnings[current_level]; --i) {
+                        --nodes[i].position;
+                        should_move = true;
+                    }
+                    child = parent;
+                    parent = nodes[child].parent;
+                    --current_level;
+                } while (should_move);
+            }
+        }
+        // Inserções à direita nunca dão problema, pois são feitas da esqueda para a direita
+        if (open && nodes[index].node->right()) {
+            nodes[index].right_index = nodes.size();
+            nodes.push_back(NodePos<NodePtr>{nodes[index].node->right(),
+                nodes[index].position + 1, index});
+        }
+        ++index;
+    }
+    // Se o último nível está completo, um índice inexistente é adicionado,
+    // então ele é removido aqui
+    if (beginnings.back() == index)
+        beginnings.pop_back();
+
+    int distance;
+    // Para cada nível, verifica a distância máxima entre um nó nas extremidades e a origem
+    for (uint i = 1; i < beginnings.size(); ++i) {
+        distance = std::max(
+            std::abs(nodes[beginnings[i]].position),
+            std::abs(nodes[beginnings[i] - 1].position)
+        );
+        if (distance > max_distance_from_origin)
+            max_distance_from_origin = distance;
+    }
+    distance = std::abs(nodes.back().position);
+    if (distance > max_distance_from_origin)
+        max_distance_from_origin = distance;
+
+    return max_distance_from_origin;
+}
+
+template<typename NodePtr>
+float* organize_data(const float radius_x, const float radius_y,
+    const std::vector<NodePos<NodePtr>>& nodes, const std::vector<int>& beginnings) {
+    const float line_height = 4.0f * radius_y;
+    // Disposição dos dados: 2 floats para a posição inicial da linha, que é
+    // o nó pai, e 2 floats para a posição final, que é seu filho.
+    float* vertices = new float[nodes.size() * 4];
+    int current_level = 1;
+    // Altura do nível acima
+    float upper_height;
+    // Altura do nível atual
+    float height = 0.99f - radius_y;
+    
+    int j = 0;
+    // Os primeiros 4 floats ligam a raiz a si mesma
+    // X do pai
+    vertices[j++] = 0.0f;
+    // Y do pai
+    vertices[j++] = height;
+    // X do filho
+    vertices[j++] = 0.0f;
+    // Y do filho
+    vertices[j++] = height;
+
+    // i: índice do nó atual, que está sendo conectado ao seu pai
+    // j: índice do vetor de dados que está sendo preenchido
+    for (int i = 1; i < nodes.size(); ++i) {
+        if (current_level < beginnings.size() && i == beginnings[current_level]) {
+            upper_height = height;
+            height -= line_height;
+            ++current_level;
+        }
+        vertices[j++] = radius_x * (2 * nodes[nodes[i].parent].position);
+        vertices[j++] = upper_height;
+        vertices[j++] = radius_x * (2 * nodes[i].position);
+        vertices[j++] = height;
+    }
+    return vertices;
+}
+
+/// Algoritmos de layout disponíveis para a visualização.
+enum class Algorithm {
+    // Busca em largura que desloca níveis inteiros ao encontrar colisões
+    Levels,
+    // Layout por contornos, em que cada subárvore é posicionada de forma
+    // independente e pode ser calculada em paralelo
+    Contour
+};
+
+// Usa o campo size do nó, se existir, para evitar uma passada extra na árvore
+template<typename NodePtr>
+auto known_size(NodePtr node, int) -> decltype(static_cast<size_t>(node->size)) {
+    return node->size;
+}
+
+template<typename NodePtr>
+size_t known_size(NodePtr, long) {
+    return 0;
+}
+
+// Contorno de uma subárvore: as posições mais à esquerda e mais à direita de
+// cada nível, do mais profundo para o mais raso, relativas à raiz da subárvore
+// depois de somar shift. Guardar o deslocamento à parte permite mover uma
+// subárvore inteira em O(1) ao posicioná-la em relação ao irmão.
+struct Contour {
+    std::vector<std::array<int, 2>> bounds;
+    int shift = 0;
+
+    size_t depth() const {
+        return this->bounds.size();
+    }
+
+    int left(size_t level) const {
+        return this->bounds[this->bounds.size() - 1 - level][0] + this->shift;
+    }
+
+    int right(size_t level) const {
+        return this->bounds[this->bounds.size() - 1 - level][1] + this->shift;
+    }
+};
+
+// Calcula o contorno do nó i a partir dos contornos dos filhos, que são
+// consumidos, e grava o deslocamento de cada filho em relação ao pai.
+// Aproxima os filhos o máximo possível mantendo distância mínima de 2 entre
+// nós vizinhos de um mesmo nível, e o custo é proporcional à altura da menor
+// subárvore, o que soma O(n) na árvore inteira.
+template<typename NodePtr>
+void combine_contours(int i, const std::vector<NodePos<NodePtr>>& nodes,
+                      std::vector<Contour>& contours, std::vector<int>& offsets) {
+    int l = nodes[i].left_index, r = nodes[i].right_index;
+    Contour& result = contours[i];
+    if (!l && !r) {
+        result.bounds.push_back({0, 0});
+        return;
+    }
+    if (!l || !r) {
+        int child = l ? l : r;
+        offsets[child] = l ? -1 : 1;
+        result = std::move(contours[child]);
+        result.shift += offsets[child];
+    } else {
+        Contour left = std::move(contours[l]);
+        Contour right = std::move(contours[r]);
+        size_t common = std::min(left.depth(), right.depth());
+        int separation = 2;
+        for (size_t level = 0; level < common; ++level)
+            separation = std::max(separation, left.right(level) - right.left(level) + 2);
+        // Separação par mantém as posições inteiras e o pai centralizado
+        separation += separation & 1;
+        offsets[l] = -separation / 2;
+        offsets[r] = separation / 2;
+        left.shift += offsets[l];
+        right.shift += offsets[r];
+        // O contorno mais profundo é reaproveitado e só a parte comum é corrigida
+        bool left_deeper = left.depth() >= right.depth();
+        result = std::move(left_deeper ? left : right);
+        const Contour& other = left_deeper ? right : left;
+        for (size_t level = 0; level < common; ++level) {
+            size_t index = result.bounds.size() - 1 - level;
+            if (left_deeper)
+                result.bounds[index][1] = other.right(level) - result.shift;
+            else
+                result.bounds[index][0] = other.left(level) - result.shift;
+        }
+    }
+    result.bounds.push_back({-result.shift, -result.shift});
+}
+
+/**
+ * Layout por contornos (no estilo de Reingold-Tilford). Preenche os vetores da
+ * mesma forma que breadth_first_search, com os nós em ordem de largura e o
+ * início de cada nível, e retorna a maior distância entre um nó e a origem.
+ *
+ * Com um pool, a árvore é dividida em subárvores independentes de até grain
+ * nós (usando Node::size, quando existe), cujos contornos são calculados em
+ * paralelo e depois unidos na parte superior da árvore; as posições finais
+ * são então propagadas nível a nível em paralelo. Como cada contorno depende
+ * apenas dos contornos dos filhos, o resultado é idêntico ao serial.
+ *
+ * @param pool Pool de threads, ou nulo para executar na thread atual.
+ * @param grain Tamanho máximo de uma subárvore tratada por uma única tarefa.
+ * @param frontier Se não for nula, deixa de fora os filhos dos nós recolhidos.
+ */
+template<typename NodePtr>
+int contour_layout(NodePtr root, std::vector<NodePos<NodePtr>>& nodes,
+                   std::vector<int>& beginnings, par::WorkStealingPool* pool = nullptr,
+                   size_t grain = 0, const Frontier<NodePtr>* frontier = nullptr) {
+    nodes.push_back(NodePos<NodePtr>{root, 0, 0});
+    beginnings.push_back(0);
+    // Ordem de largura: os filhos sempre aparecem depois do pai
+    size_t level_begin = 0;
+    while (level_begin < nodes.size()) {
+        size_t level_end = nodes.size();
+        for (size_t i = level_begin; i < level_end; ++i) {
+            NodePtr node = nodes[i].node;
+            if (!expanded(nodes[i], static_cast<int>(beginnings.size()) - 1, frontier))
+                continue;
+            if (node->left()) {
+                nodes[i].left_index = nodes.size();
+                nodes.push_back(NodePos<NodePtr>{node->left(), 0, static_cast<int>(i)});
+            }
+            if (node->right()) {
+                nodes[i].right_index = nodes.size();
+                nodes.push_back(NodePos<NodePtr>{node->right(), 0, static_cast<int>(i)});
+            }
+        }
+        if (nodes.size() > level_end)
+            beginnings.push_back(level_end);
+        level_begin = level_end;
+    }
+
+    const size_t n = nodes.size();
+    std::vector<Contour> contours(n);
+    std::vector<int> offsets(n, 0);
+    if (!pool || pool->size() == 1) {
+        for (size_t i = n; i-- > 0;)
+            combine_contours(static_cast<int>(i), nodes, contours, offsets);
+    } else {
+        if (grain == 0)
+            grain = std::max<size_t>(n / (pool->size() * 16), 4096);
+        // Tamanho de cada subárvore, vindo do nó ou calculado de baixo para cima
+        std::vector<size_t> sizes(n);
+        if (known_size(root, 0) == n) {
+            for (size_t i = 0; i < n; ++i)
+                sizes[i] = known_size(nodes[i].node, 0);
+        } else {
+            for (size_t i = n; i-- > 0;) {
+                sizes[i] = 1 + (nodes[i].left_index ? sizes[nodes[i].left_index] : 0) +
+                    (nodes[i].right_index ? sizes[nodes[i].right_index] : 0);
+            }
+        }
+        // Nós grandes demais ficam na parte superior, e seus filhos pequenos viram tarefas
+        std::vector<int> top;
+        std::vector<int> tasks;
+        if (sizes[0] <= grain) {
+            tasks.push_back(0);
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                if (sizes[i] <= grain)
+                    continue;
+                top.push_back(i);
+                for (int child : {nodes[i].left_index, nodes[i].right_index}) {
+                    if (child && sizes[child] <= grain)
+                        tasks.push_back(child);
+                }
+            }
+        }
+        // As maiores primeiro, para que as pequenas equilibrem o fim da execução
+        std::sort(tasks.begin(), tasks.end(), [&sizes](int a, int b) {
+            return sizes[a] > sizes[b];
+        });
+        par::TaskGroup group(*pool);
+        for (int task : tasks) {
+            group.run([task, &nodes, &contours, &offsets] {
+                // Ordem de largura local, percorrida de trás para frente
+                std::vector<int> order{task};
+                for (size_t k = 0; k < order.size(); ++k) {
+                    if (nodes[order[k]].left_index)
+                        order.push_back(nodes[order[k]].left_index);
+                    if (nodes[order[k]].right_index)
+                        order.push_back(nodes[order[k]].right_index);
+                }
+                for (size_t k = order.size(); k-- > 0;)
+                    combine_contours(order[k], nodes, contours, offsets);
+            });
+        }
+        group.wait();
+        for (size_t k = top.size(); k-- > 0;)
+            combine_contours(top[k], nodes, contours, offsets);
+    }
+    contours.clear();
+    contours.shrink_to_fit();
+
+    // Propaga as posições da raiz para baixo, nível a nível
+    int max_distance_from_origin = 0;
+    std::mutex max_mutex;
+    for (size_t level = 1; level < beginnings.size(); ++level) {
+        size_t first = beginnings[level];
+        size_t last = level + 1 < beginnings.size() ? beginnings[level + 1] : n;
+        par::parallel_for(pool, first, last, 16384, [&](size_t begin, size_t end) {
+            int distance = 0;
+            for (size_t i = begin; i < end; ++i) {
+                nodes[i].position = nodes[nodes[i].parent].position + offsets[i];
+                distance = std::max(distance, std::abs(nodes[i].position));
+            }
+            std::lock_guard<std::mutex> lock(max_mutex);
+            max_distance_from_origin = std::max(max_distance_from_origin, distance);
+        });
+    }
+    return max_distance_from_origin;
+}
+
+/// Versão de organize_data que preenche os vértices em paralelo. As alturas
+/// de cada nível são acumuladas como na versão serial, então o resultado é o mesmo.
+template<typename NodePtr>
+float* organize_data(const float radius_x, const float radius_y,
+    const std::vector<NodePos<NodePtr>>& nodes, const std::vector<int>& beginnings,
+    par::WorkStealingPool* pool) {
+    if (!pool || pool->size() == 1)
+        return organize_data(radius_x, radius_y, nodes, beginnings);
+    const float line_height = 4.0f * radius_y;
+    std::vector<float> heights(beginnings.size());
+    heights[0] = 0.99f - radius_y;
+    for (size_t level = 1; level < heights.size(); ++level)
+        heights[level] = heights[level - 1] - line_height;
+
+    float* vertices = new float[nodes.size() * 4];
+    vertices[0] = 0.0f;
+    vertices[1] = heights[0];
+    vertices[2] = 0.0f;
+    vertices[3] = heights[0];
+    for (size_t level = 1; level < beginnings.size(); ++level) {
+        size_t first = beginnings[level];
+        size_t last = level + 1 < beginnings.size() ? beginnings[level + 1] : nodes.size();
+        const float upper_height = heights[level - 1];
+        const float height = heights[level];
+        par::parallel_for(pool, first, last, 16384, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                float* vertex = vertices + 4 * i;
+                vertex[0] = radius_x * (2 * nodes[nodes[i].parent].position);
+                vertex[1] = upper_height;
+                vertex[2] = radius_x * (2 * nodes[i].position);
+                vertex[3] = height;
+            }
+        });
+    }
+    return vertices;
+}
+
+}  // namespace layout
+
+#endif  // LAYOUT_HPP_
@@ -0,0 +1,225 @@
+#ifndef LOOKUP_HPP_
+#define LOOKUP_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/*
+    Índice auxiliar opcional da BST para buscas por chave exata: um filtro de
+    Bloom que descarta rapidamente chaves ausentes e uma tabela hash de
+    endereçamento aberto da chave para o nó. A árvore mantém o índice a cada
+    inserção e remoção e o reconstrói depois de operações em lote; operações
+    ordenadas continuam usando só a árvore.
+*/
+
+namespace lookup {
+
+// Finalizador do splitmix64: espalha hashes fracos, como o identidade de std::hash<int>
+inline uint64_t mix(uint64_t hash) {
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+/**
+ * Filtro de Bloom em blocos de 512 bits: todos os bits de uma chave ficam na
+ * mesma linha de cache, então uma consulta custa no máximo uma falta de
+ * cache. Com 10 bits por chave e 6 bits por consulta, a taxa de falsos
+ * positivos fica perto de 1%.
+ */
+class BloomFilter {
+ public:
+    static constexpr size_t bits_per_key = 10;
+    static constexpr unsigned probes = 6;
+
+    explicit BloomFilter(size_t keys = 0) {
+        this->resize(keys);
+    }
+
+    /// Descarta o conteúdo e dimensiona o filtro para keys chaves.
+    void resize(size_t keys) {
+        this->blocks = std::max<size_t>(1, (keys * bits_per_key + 511) / 512);
+        this->words.assign(this->blocks * 8, 0);
+    }
+
+    void add(uint64_t hash) {
+        uint64_t* block = this->words.data() + this->block(hash);
+        uint64_t bits = hash * 0x9e3779b97f4a7c15ULL;
+        for (unsigned i = 0; i < probes; ++i) {
+            unsigned bit = (bits >> (9 * i)) & 511;
+            block[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+    }
+
+    /// Falso quando a chave com esse hash certamente não foi adicionada.
+    bool may_contain(uint64_t hash) const {
+        const uint64_t* block = this->words.data() + this->block(hash);
+        uint64_t bits = hash * 0x9e3779b97f4a7c15ULL;
+        for (unsigned i = 0; i < probes; ++i) {
+            unsigned bit = (bits >> (9 * i)) & 511;
+            if (!(block[bit / 64] & (uint64_t(1) << (bit % 64))))
+                return false;
+        }
+        return true;
+    }
+
+    size_t bytes() const {
+        return this->words.size() * sizeof(uint64_t);
+    }
+
+ private:
+    std::vector<uint64_t> words;
+    size_t blocks = 1;
+
+    // Posição da primeira palavra do bloco, escolhido pelos bits altos sem divisão
+    size_t block(uint64_t hash) const {
+        return static_cast<size_t>((static_cast<unsigned __int128>(hash) * this->blocks) >> 64) * 8;
+    }
+};
+
+/**
+ * Tabela hash com sondagem linear de chave para nó, sem tombstones: a
+ * remoção desloca para trás os elementos seguintes do mesmo grupo. A carga
+ * fica abaixo de 1/2, e o filtro de Bloom é refeito quando a tabela cresce
+ * ou quando as chaves removidas, que continuam marcadas nele, passam da
+ * metade das presentes.
+ *
+ * O hash deve ser compatível com o comparador da árvore: chaves que ela
+ * considera iguais precisam ter o mesmo hash.
+ */
+template<class K, class Node, class Hash = std::hash<K>>
+class Index {
+ public:
+    explicit Index(Hash hash = Hash()) : hash(hash) {
+        this->clear();
+    }
+
+    size_t size() const {
+        return this->count;
+    }
+
+    /// Memória da tabela e do filtro.
+    size_t bytes() const {
+        return this->slots.size() * sizeof(Slot) + this->filter.bytes();
+    }
+
+    void clear() {
+        this->slots.assign(16, Slot{0, nullptr});
+        this->count = 0;
+        this->rebuild_filter();
+    }
+
+    /// Prepara o índice para keys chaves sem crescer durante as inserções.
+    void reserve(size_t keys) {
+        size_t capacity = 16;
+        while (capacity < 2 * keys + 2)
+            capacity *= 2;
+        if (capacity > this->slots.size())
+            this->rehash(capacity);
+    }
+
+    /// Adiciona um nó cuja chave ainda não está no índice.
+    void insert(Node* node) {
+        if (2 * (this->count + 1) > this->slots.size())
+            this->rehash(2 * this->slots.size());
+        uint64_t hash = this->hash_of(node->m_key);
+        this->place(Slot{hash, node});
+        this->filter.add(hash);
+        ++this->count;
+    }
+
+    void erase(const Node* node) {
+        size_t mask = this->slots.size() - 1;
+        size_t index = this->hash_of(node->m_key) & mask;
+        while (this->slots[index].node != node)
+            index = (index + 1) & mask;
+        // Desloca para trás os elementos que não ficariam mais acessíveis
+        size_t next = (index + 1) & mask;
+        while (this->slots[next].node) {
+            size_t home = this->slots[next].hash & mask;
+            if (((next - home) & mask) >= ((next - index) & mask)) {
+                this->slots[index] = this->slots[next];
+                index = next;
+            }
+            next = (next + 1) & mask;
+        }
+        this->slots[index] = Slot{0, nullptr};
+        --this->count;
+        if (++this->removed > this->count / 2 + 16)
+            this->rebuild_filter();
+    }
+
+    /**
+     * Retorna o nó da chave, ou nullptr. equal(chave, nó) confirma as chaves
+     * com o mesmo hash, usando o comparador da árvore.
+     */
+    template<class Equal>
+    Node* find(const K& key, Equal equal) const {
+        uint64_t hash = this->hash_of(key);
+        if (!this->filter.may_contain(hash))
+            return nullptr;
+        size_t mask = this->slots.size() - 1;
+        for (size_t index = hash & mask; this->slots[index].node; index = (index + 1) & mask) {
+            const Slot& slot = this->slots[index];
+            if (slot.hash == hash && equal(key, slot.node))
+                return slot.node;
+        }
+        return nullptr;
+    }
+
+ private:
+    struct Slot {
+        uint64_t hash;
+        Node* node;
+    };
+
+    std::vector<Slot> slots;
+    BloomFilter filter;
+    size_t count = 0;
+    // Remoções desde que o filtro foi refeito
+    size_t removed = 0;
+    Hash hash;
+
+    uint64_t hash_of(const K& key) const {
+        return mix(static_cast<uint64_t>(this->hash(key)));
+    }
+
+    void place(Slot slot) {
+        size_t mask = this->slots.size() - 1;
+        size_t index = slot.hash & mask;
+        while (this->slots[index].node)
+            index = (index + 1) & mask;
+        this->slots[index] = slot;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old(capacity, Slot{0, nullptr});
+        old.swap(this->slots);
+        for (const Slot& slot : old) {
+            if (slot.node)
+                this->place(slot);
+        }
+        this->rebuild_filter();
+    }
+
+    // O filtro é dimensionado para a carga máxima da tabela
+    void rebuild_filter() {
+        this->filter.resize(this->slots.size() / 2);
+        for (const Slot& slot : this->slots) {
+            if (slot.node)
+                this->filter.add(slot.hash);
+        }
+        this->removed = 0;
+    }
+};
+
+}  // namespace lookup
+
+#endif  // LOOKUP_HPP_
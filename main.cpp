@@ -18,12 +18,10 @@ void add_int_elements(int count, vector<int>& vec, BST<int, int>& bst) {
     static std::mt19937 gen(rd());
     static std::uniform_int_distribution<int> distrib(-99, 99);
     for (int i = 0; i < count; ++i) {
-        try {
-            int value = distrib(gen);
+        int value = distrib(gen);
+        if (bst.try_insert(value, value).second) {
             vec.push_back(value);
-            bst.insert(value, value);
-        } catch (std::invalid_argument& e) {
-            vec.pop_back();
+        } else {
             --i;
         }
     }
@@ -34,12 +32,10 @@ void add_float_elements(int count, vector<float>& vec, BST<float, float>& bst) {
     static std::mt19937 gen(rd());
     static std::uniform_real_distribution<float> distrib(-999, 999);
     for (int i = 0; i < count; ++i) {
-        try {
-            float value = distrib(gen);
+        float value = distrib(gen);
+        if (bst.try_insert(value, value).second) {
             vec.push_back(value);
-            bst.insert(value, value);
-        } catch (std::invalid_argument& e) {
-            vec.pop_back();
+        } else {
             --i;
         }
     }
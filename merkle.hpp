@@ -0,0 +1,259 @@
+#ifndef MERKLE_HPP_
+#define MERKLE_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "./lookup.hpp"
+
+/*
+    Hashes de subárvore opcionais da BST, escolhidos pelo quinto parâmetro de
+    template. Cada nó guarda a soma (módulo 2^64) dos hashes dos pares
+    (chave, valor) da sua subárvore, mantida como size: a inserção soma o
+    hash do nó novo aos ancestrais, e remoções e rotações recalculam os nós
+    afetados em O(1) cada. Como a soma não depende do formato, duas árvores
+    com o mesmo conteúdo têm o mesmo hash na raiz mesmo com formatos
+    diferentes, e o hash das chaves de um intervalo sai em O(altura).
+
+    Assim, a igualdade de conteúdo é uma comparação de hashes, e diff
+    descarta toda subárvore cujo hash é igual ao do mesmo intervalo na outra
+    árvore, visitando só os caminhos até as mudanças. As comparações são
+    probabilísticas: conteúdos diferentes têm o mesmo hash com chance perto
+    de 2^-64.
+*/
+
+namespace merkle {
+
+/// Nós sem hash.
+struct None {
+    static constexpr bool enabled = false;
+};
+
+/// Hash de cada par a partir de std::hash da chave e do valor.
+struct Content {
+    static constexpr bool enabled = true;
+
+    template<class K, class V>
+    static uint64_t entry(const K& key, const V& value) {
+        uint64_t hash = lookup::mix(static_cast<uint64_t>(std::hash<K>()(key)));
+        return lookup::mix(hash + static_cast<uint64_t>(std::hash<V>()(value)));
+    }
+};
+
+/// Campo opcional dos nós com o hash da subárvore.
+template<class Digest, bool enabled = Digest::enabled>
+struct HashField {
+    using digest = Digest;
+    uint64_t m_hash = 0;
+};
+
+template<class Digest>
+struct HashField<Digest, false> {};
+
+template<class Node, class = void>
+struct is_hashed : std::false_type {};
+
+template<class Node>
+struct is_hashed<Node, std::void_t<decltype(std::declval<Node&>().m_hash)>> : std::true_type {};
+
+template<class Node>
+uint64_t hash_of(const Node* node) {
+    return node ? node->m_hash : 0;
+}
+
+/// Hash só do par do nó, sem os filhos.
+template<class Node>
+uint64_t entry_of(const Node* node) {
+    return node->m_hash - hash_of(node->m_left) - hash_of(node->m_right);
+}
+
+/// Recalcula o hash do nó a partir dos filhos. Não faz nada em nós sem hash.
+template<class Node>
+void update(Node* node) {
+    if constexpr (is_hashed<Node>::value) {
+        node->m_hash = hash_of(node->m_left) + hash_of(node->m_right) +
+            Node::digest::entry(node->m_key, node->m_value);
+    }
+}
+
+/// Recalcula os hashes de uma árvore inteira em pós-ordem, sem recursão.
+template<class Node>
+void rebuild(Node* root) {
+    if (!is_hashed<Node>::value || !root)
+        return;
+    auto first = [](Node* node) {
+        while (node->m_left || node->m_right)
+            node = node->m_left ? node->m_left : node->m_right;
+        return node;
+    };
+    Node* node = first(root);
+    while (true) {
+        update(node);
+        if (node == root)
+            return;
+        Node* parent = node->m_parent;
+        node = parent->m_left == node && parent->m_right ? first(parent->m_right) : parent;
+    }
+}
+
+/// Diferenças de uma árvore a para uma árvore b.
+template<class Node>
+struct Diff {
+    // Nós de b cujas chaves não estão em a
+    std::vector<Node*> added;
+    // Nós de a cujas chaves não estão em b
+    std::vector<Node*> removed;
+    // Pares (nó de a, nó de b) com a mesma chave e valores diferentes
+    std::vector<std::pair<Node*, Node*>> changed;
+
+    bool empty() const {
+        return this->added.empty() && this->removed.empty() && this->changed.empty();
+    }
+
+    /// Nós de b que são novos ou mudaram, para destacar na visualização.
+    std::vector<Node*> marked() const {
+        std::vector<Node*> nodes(this->added);
+        for (const auto& pair : this->changed)
+            nodes.push_back(pair.second);
+        return nodes;
+    }
+};
+
+/**
+ * Compara duas árvores pelos hashes, descendo só onde eles diferem.
+ * order(x, y) compara a chave do nó x com a do nó y, como BST::compare_nodes.
+ *
+ * Enquanto as duas árvores têm a mesma chave na mesma posição, as subárvores
+ * correspondentes cobrem o mesmo intervalo e são comparadas diretamente, o
+ * que dá O(mudanças × altura) quando a é uma cópia de b alterada sem
+ * rebalanceamento. Onde os formatos divergem, cada subárvore de a é
+ * comparada com a soma do mesmo intervalo em b, em O(altura) por nó visitado.
+ */
+template<class Node, class Order>
+Diff<Node> diff(Node* a, Node* b, Order order) {
+    static_assert(is_hashed<Node>::value, "diff requires nodes with subtree hashes.");
+    // Intervalo aberto (lo, hi) dado por nós de a; nullptr não limita
+    struct Task {
+        Node* x;
+        Node* y;
+        Node* lo;
+        Node* hi;
+        bool aligned;
+    };
+    Diff<Node> result;
+    auto above = [&order](const Node* lo, const Node* node) {
+        return !lo || order(lo, node) < 0;
+    };
+    auto below = [&order](const Node* hi, const Node* node) {
+        return !hi || order(hi, node) > 0;
+    };
+    // Menor subárvore de y que contém todas as chaves do intervalo
+    auto narrow = [&](Node* y, Node* lo, Node* hi) {
+        while (y) {
+            if (!above(lo, y))
+                y = y->m_right;
+            else if (!below(hi, y))
+                y = y->m_left;
+            else
+                break;
+        }
+        return y;
+    };
+    auto range_hash = [&](Node* y, Node* lo, Node* hi) {
+        y = narrow(y, lo, hi);
+        if (!y)
+            return uint64_t(0);
+        uint64_t sum = entry_of(y);
+        for (Node* node = y->m_left; node;) {
+            if (above(lo, node)) {
+                sum += entry_of(node) + hash_of(node->m_right);
+                node = node->m_left;
+            } else {
+                node = node->m_right;
+            }
+        }
+        for (Node* node = y->m_right; node;) {
+            if (below(hi, node)) {
+                sum += entry_of(node) + hash_of(node->m_left);
+                node = node->m_right;
+            } else {
+                node = node->m_left;
+            }
+        }
+        return sum;
+    };
+    // Adiciona a out os nós de root dentro do intervalo
+    auto collect = [&](Node* root, Node* lo, Node* hi, std::vector<Node*>& out) {
+        std::vector<Node*> stack;
+        if (root)
+            stack.push_back(root);
+        while (!stack.empty()) {
+            Node* node = stack.back();
+            stack.pop_back();
+            bool after_lo = above(lo, node);
+            bool before_hi = below(hi, node);
+            if (after_lo && before_hi)
+                out.push_back(node);
+            if (after_lo && node->m_left)
+                stack.push_back(node->m_left);
+            if (before_hi && node->m_right)
+                stack.push_back(node->m_right);
+        }
+    };
+    auto compare_entries = [&](Node* x, Node* y) {
+        if (entry_of(x) != entry_of(y))
+            result.changed.emplace_back(x, y);
+    };
+
+    std::vector<Task> tasks{Task{a, b, nullptr, nullptr, true}};
+    while (!tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+        Node* x = task.x;
+        Node* y = task.y;
+        if (!x) {
+            collect(y, task.lo, task.hi, result.added);
+            continue;
+        }
+        if (task.aligned) {
+            if (!y) {
+                collect(x, nullptr, nullptr, result.removed);
+                continue;
+            }
+            if (x->size == y->size && x->m_hash == y->m_hash)
+                continue;
+            if (order(x, y) == 0) {
+                compare_entries(x, y);
+                tasks.push_back(Task{x->m_left, y->m_left, task.lo, x, true});
+                tasks.push_back(Task{x->m_right, y->m_right, x, task.hi, true});
+                continue;
+            }
+        } else {
+            y = narrow(y, task.lo, task.hi);
+            if (x->m_hash == range_hash(y, task.lo, task.hi))
+                continue;
+        }
+        // Os formatos divergem: procura a chave de x no intervalo de b
+        Node* match = y;
+        while (match) {
+            int side = order(x, match);
+            if (side == 0)
+                break;
+            match = side < 0 ? match->m_left : match->m_right;
+        }
+        if (match)
+            compare_entries(x, match);
+        else
+            result.removed.push_back(x);
+        tasks.push_back(Task{x->m_left, y, task.lo, x, false});
+        tasks.push_back(Task{x->m_right, y, x, task.hi, false});
+    }
+    return result;
+}
+
+}  // namespace merkle
+
+#endif  // MERKLE_HPP_
@@ -0,0 +1,487 @@
+#ifndef PAGED_HPP_
+#define PAGED_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "./compare.hpp"
+#include "./stats.hpp"
+
+/*
+    Árvore somente leitura guardada em um arquivo mapeado em memória, para
+    inspecionar árvores maiores que a RAM. Os nós são agrupados em blocos do
+    tamanho de uma página: cada bloco guarda os primeiros nós, em largura, de
+    uma subárvore, e as subárvores que não couberem começam blocos novos.
+    Assim, um caminho da raiz até uma folha de uma árvore balanceada passa
+    por cerca de altura / log2(nós por bloco) blocos.
+
+        cabeçalho   primeira página, com 64 bytes usados
+        blocos      page_size bytes cada, com page_size / sizeof(Record)
+                    registros {esquerdo, direito, chave, valor}
+
+    Os nós são identificados por bloco * nós_por_bloco + posição no bloco.
+    Chaves e valores são gravados na representação nativa da máquina, então
+    precisam ser trivialmente copiáveis.
+*/
+
+namespace paged {
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint32_t key_size;
+    uint32_t value_size;
+    uint64_t page_size;
+    uint64_t per_page;
+    uint64_t count;
+    uint64_t pages;
+    uint64_t root;
+};
+
+static_assert(sizeof(Header) == 64, "Header must be 64 bytes.");
+
+constexpr char magic[8] = {'B', 'S', 'T', 'P', 'A', 'G', 'E', '\0'};
+constexpr uint32_t version = 1;
+constexpr uint32_t endian_marker = 0x01020304;
+constexpr uint64_t null = UINT64_MAX;
+
+template<class K, class V>
+struct Record {
+    uint64_t m_left;
+    uint64_t m_right;
+    K m_key;
+    V m_value;
+};
+
+inline size_t system_page_size() {
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+/**
+ * Nó implícito de uma árvore perfeitamente balanceada sobre arrays
+ * ordenados, que se comporta como ponteiro. Permite gravar uma árvore a
+ * partir de chaves que também estão em disco, como as de um MappedSnapshot.
+ */
+template<class K, class V>
+class SortedRange {
+ public:
+    // Quantidade de nós da subárvore, como o campo size da BST
+    size_t size;
+
+    SortedRange(const K* keys = nullptr, const V* values = nullptr, size_t begin = 0, size_t count = 0)
+        : size(count), keys(keys), values(values), begin(begin) {}
+
+    const SortedRange* operator->() const {
+        return this;
+    }
+
+    explicit operator bool() const {
+        return this->size > 0;
+    }
+
+    SortedRange left() const {
+        return SortedRange(this->keys, this->values, this->begin, this->size / 2);
+    }
+
+    SortedRange right() const {
+        return SortedRange(this->keys, this->values, this->middle() + 1, this->size - this->size / 2 - 1);
+    }
+
+    K key() const {
+        return this->keys[this->middle()];
+    }
+
+    V value() const {
+        return this->values[this->middle()];
+    }
+
+ private:
+    const K* keys;
+    const V* values;
+    size_t begin;
+
+    size_t middle() const {
+        return this->begin + this->size / 2;
+    }
+};
+
+/**
+ * Grava a árvore com a mesma forma, a partir de qualquer nó com os métodos
+ * left, right, key e value. Se o nó também tiver o campo size, subárvores
+ * menores que um bloco são gravadas inteiras e juntas em blocos
+ * compartilhados; sem ele, cada subárvore que não couber no bloco do pai
+ * começa um bloco próprio, que pode ficar quase vazio perto das folhas. Usa
+ * memória proporcional à quantidade de blocos ainda não gravados, não à de
+ * nós.
+ *
+ * @param page_size Tamanho de cada bloco, múltiplo da página do sistema. Com
+ *        0, é usada a própria página do sistema.
+ */
+template<class NodePtr>
+void write(NodePtr root, const std::string& path, size_t page_size = 0) {
+    using K = std::decay_t<decltype(root->key())>;
+    using V = std::decay_t<decltype(root->value())>;
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+        "Keys and values must be trivially copyable.");
+    using Block = Record<K, V>;
+    if (page_size == 0)
+        page_size = system_page_size();
+    if (page_size % system_page_size() != 0 || page_size < sizeof(Block))
+        throw std::invalid_argument("Page size must be a multiple of the system page size.");
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.endian = endian_marker;
+    header.key_size = sizeof(K);
+    header.value_size = sizeof(V);
+    header.page_size = page_size;
+    header.per_page = page_size / sizeof(Block);
+    header.root = root ? 0 : null;
+
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    if (!os)
+        throw std::runtime_error("Could not open " + path + ".");
+    std::vector<char> page(page_size, 0);
+    os.write(page.data(), page_size);
+
+    // Subárvores de cada bloco ainda não gravado, com a posição da raiz no bloco.
+    // pending[0] é o bloco current, e os números são dados em ordem crescente.
+    std::deque<std::vector<std::pair<NodePtr, uint64_t>>> pending;
+    if (root) {
+        pending.emplace_back(1, std::make_pair(root, uint64_t(0)));
+        header.pages = 1;
+    }
+    // Último bloco compartilhado aberto e quantas posições dele já foram reservadas
+    uint64_t shared = null;
+    uint64_t reserved = 0;
+    std::vector<NodePtr> nodes;
+    for (uint64_t current = 0; !pending.empty(); ++current) {
+        std::fill(page.begin(), page.end(), 0);
+        for (const std::pair<NodePtr, uint64_t>& subtree : pending.front()) {
+            nodes.assign(1, subtree.first);
+            uint64_t used = subtree.second + 1;
+            // Filhos entram no bloco atual enquanto houver espaço, em largura
+            auto place = [&](NodePtr child) -> uint64_t {
+                if (!child)
+                    return null;
+                if (used < header.per_page) {
+                    nodes.push_back(child);
+                    return current * header.per_page + used++;
+                }
+                uint64_t target = header.pages;
+                uint64_t slot = 0;
+                if constexpr (stats::has_size<NodePtr>::value) {
+                    uint64_t size = stats::size_of(child);
+                    if (size < header.per_page) {
+                        if (shared == null || shared <= current || reserved + size > header.per_page) {
+                            shared = header.pages;
+                            reserved = 0;
+                        }
+                        target = shared;
+                        slot = reserved;
+                        reserved += size;
+                    }
+                }
+                if (target == header.pages) {
+                    ++header.pages;
+                    pending.emplace_back();
+                }
+                pending[target - current].emplace_back(child, slot);
+                return target * header.per_page + slot;
+            };
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                NodePtr node = nodes[i];
+                uint64_t slot = subtree.second + i;
+                Block block;
+                block.m_left = place(node->left());
+                block.m_right = place(node->right());
+                block.m_key = node->key();
+                block.m_value = node->value();
+                std::memcpy(page.data() + slot * sizeof(Block), &block, sizeof(Block));
+            }
+            header.count += nodes.size();
+        }
+        pending.pop_front();
+        os.write(page.data(), page_size);
+    }
+    os.seekp(0);
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.flush();
+    if (!os)
+        throw std::runtime_error("Could not write " + path + ".");
+}
+
+/// Grava uma árvore perfeitamente balanceada com as chaves ordenadas dadas.
+template<class K, class V>
+void build(const K* keys, const V* values, size_t count, const std::string& path,
+           size_t page_size = 0) {
+    write(SortedRange<K, V>(keys, values, 0, count), path, page_size);
+}
+
+/**
+ * Árvore gravada por write, lida diretamente do arquivo mapeado. No máximo
+ * resident_bytes de blocos ficam na memória por vez: um cache CLOCK registra
+ * os blocos acessados e, quando enche, libera o bloco escolhido com
+ * madvise(MADV_DONTNEED) e também o retira do page cache, já que o kernel
+ * mapeia junto, a cada falta de página, as páginas vizinhas que estiverem
+ * nele. Pelo mesmo motivo, o arquivo inteiro é retirado do page cache na
+ * abertura, e cada falta no cache passa a ser uma leitura do disco.
+ *
+ * Ponteiros e nós obtidos continuam válidos enquanto a árvore existir, mas
+ * acessá-los pode recarregar um bloco fora do limite do cache. O cache é
+ * alterado mesmo por métodos constantes, então a árvore deve ser usada por
+ * uma thread por vez.
+ */
+template<class K, class V, class Compare = cmp::ThreeWay>
+class PagedTree {
+ public:
+    using key_type = K;
+    using mapped_type = V;
+    using Block = Record<K, V>;
+
+    /// Referência a um nó que se comporta como ponteiro, com os métodos que a Visualization usa.
+    class NodeRef {
+     public:
+        NodeRef(const PagedTree* tree = nullptr, uint64_t id = null) : tree(tree), id(id) {}
+
+        const NodeRef* operator->() const {
+            return this;
+        }
+
+        explicit operator bool() const {
+            return this->id != null;
+        }
+
+        bool operator==(const NodeRef& other) const {
+            return this->id == other.id && this->tree == other.tree;
+        }
+
+        bool operator!=(const NodeRef& other) const {
+            return !(*this == other);
+        }
+
+        // Visualização:
+        NodeRef left() const {
+            return NodeRef(this->tree, this->tree->block(this->id).m_left);
+        }
+
+        NodeRef right() const {
+            return NodeRef(this->tree, this->tree->block(this->id).m_right);
+        }
+
+        K key() const {
+            return this->tree->block(this->id).m_key;
+        }
+
+        V value() const {
+            return this->tree->block(this->id).m_value;
+        }
+
+        uint64_t get_id() const {
+            return this->id;
+        }
+
+     private:
+        const PagedTree* tree;
+        uint64_t id;
+    };
+
+    /// @param resident_bytes Limite de memória dos blocos mapeados, de pelo menos um bloco.
+    PagedTree(const std::string& path, size_t resident_bytes) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Could not open " + path + ".");
+        struct stat info;
+        if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+            close(fd);
+            throw std::runtime_error("Invalid paged tree " + path + ".");
+        }
+        this->length = info.st_size;
+        this->data = mmap(nullptr, this->length, PROT_READ, MAP_SHARED, fd, 0);
+        if (this->data == MAP_FAILED) {
+            close(fd);
+            this->data = nullptr;
+            throw std::runtime_error("Could not map " + path + ".");
+        }
+        try {
+            std::memcpy(&this->header, this->data, sizeof(Header));
+            this->validate();
+        } catch (...) {
+            munmap(this->data, this->length);
+            close(fd);
+            throw;
+        }
+        this->fd = fd;
+        // Sem leitura antecipada, cada falta de página carrega só a página acessada
+        madvise(this->data, this->length, MADV_RANDOM);
+        madvise(this->data, this->header.page_size, MADV_DONTNEED);
+        // Páginas ainda não gravadas no disco não podem sair do page cache
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        this->capacity = std::max<size_t>(1, resident_bytes / this->header.page_size);
+        this->slots.assign(this->header.pages, none);
+    }
+
+    ~PagedTree() {
+        if (this->data)
+            munmap(this->data, this->length);
+        if (this->fd >= 0)
+            close(this->fd);
+    }
+
+    PagedTree(const PagedTree&) = delete;
+
+    PagedTree& operator=(const PagedTree&) = delete;
+
+    size_t size() const {
+        return this->header.count;
+    }
+
+    size_t page_size() const {
+        return this->header.page_size;
+    }
+
+    size_t file_bytes() const {
+        return this->length;
+    }
+
+    NodeRef get_root() const {
+        return NodeRef(this, this->header.root);
+    }
+
+    /// Blocos mapeados atualmente segundo o cache.
+    size_t cached_pages() const {
+        return this->resident.size();
+    }
+
+    /// Acessos a blocos fora do cache desde a abertura.
+    size_t misses() const {
+        return this->miss_count;
+    }
+
+    /// Retorna um ponteiro para o valor da chave no arquivo, ou nulo se ela não existir.
+    const V* find(const K& key) const {
+        uint64_t id = this->header.root;
+        while (id != null) {
+            const Block& node = this->block(id);
+            int order = this->compare(key, node.m_key);
+            if (order == 0)
+                return &node.m_value;
+            id = order < 0 ? node.m_left : node.m_right;
+        }
+        return nullptr;
+    }
+
+    const V& search(const K& key) const {
+        const V* value = this->find(key);
+        if (!value)
+            throw std::invalid_argument("Key" + cmp::describe(key) + " not found.");
+        return *value;
+    }
+
+    /// Chama f(chave, valor) em ordem simétrica, com uma pilha proporcional à altura.
+    template<class Function>
+    void for_each(Function f) const {
+        std::vector<uint64_t> stack;
+        uint64_t id = this->header.root;
+        while (id != null || !stack.empty()) {
+            while (id != null) {
+                stack.push_back(id);
+                id = this->block(id).m_left;
+            }
+            id = stack.back();
+            stack.pop_back();
+            const Block& node = this->block(id);
+            f(node.m_key, node.m_value);
+            id = node.m_right;
+        }
+    }
+
+ private:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    void* data = nullptr;
+    size_t length = 0;
+    int fd = -1;
+    Header header;
+    Compare compare;
+    size_t capacity = 1;
+    // Posição de cada bloco no cache, ou none
+    mutable std::vector<uint32_t> slots;
+    mutable std::vector<uint64_t> resident;
+    mutable std::vector<uint8_t> referenced;
+    mutable size_t hand = 0;
+    mutable size_t miss_count = 0;
+
+    char* page_address(uint64_t page) const {
+        return static_cast<char*>(this->data) + (page + 1) * this->header.page_size;
+    }
+
+    const Block& block(uint64_t id) const {
+        uint64_t page = id / this->header.per_page;
+        this->touch(page);
+        return reinterpret_cast<const Block*>(this->page_address(page))[id % this->header.per_page];
+    }
+
+    // Registra o acesso ao bloco, liberando outro pelo algoritmo CLOCK se o cache estiver cheio
+    void touch(uint64_t page) const {
+        uint32_t& slot = this->slots[page];
+        if (slot != none) {
+            this->referenced[slot] = 1;
+            return;
+        }
+        ++this->miss_count;
+        if (this->resident.size() < this->capacity) {
+            slot = static_cast<uint32_t>(this->resident.size());
+            this->resident.push_back(page);
+            this->referenced.push_back(1);
+            return;
+        }
+        while (this->referenced[this->hand]) {
+            this->referenced[this->hand] = 0;
+            this->hand = (this->hand + 1) % this->capacity;
+        }
+        uint64_t victim = this->resident[this->hand];
+        madvise(this->page_address(victim), this->header.page_size, MADV_DONTNEED);
+        posix_fadvise(this->fd, (victim + 1) * this->header.page_size, this->header.page_size,
+            POSIX_FADV_DONTNEED);
+        this->slots[victim] = none;
+        this->resident[this->hand] = page;
+        this->referenced[this->hand] = 1;
+        slot = static_cast<uint32_t>(this->hand);
+        this->hand = (this->hand + 1) % this->capacity;
+    }
+
+    void validate() const {
+        const Header& header = this->header;
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+            throw std::runtime_error("Not a paged tree.");
+        if (header.version != version || header.endian != endian_marker)
+            throw std::runtime_error("Unsupported paged tree version or byte order.");
+        if (header.key_size != sizeof(K) || header.value_size != sizeof(V))
+            throw std::runtime_error("Paged tree key or value type does not match.");
+        if (header.page_size % system_page_size() != 0 || header.per_page != header.page_size / sizeof(Block))
+            throw std::runtime_error("Invalid paged tree page size.");
+        if ((header.pages + 1) * header.page_size > this->length)
+            throw std::runtime_error("Truncated paged tree.");
+    }
+};
+
+}  // namespace paged
+
+#endif  // PAGED_HPP_
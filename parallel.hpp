@@ -0,0 +1,470 @@
+#ifndef PARALLEL_HPP_
+#define PARALLEL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Escalonador de tarefas com roubo de trabalho (work stealing) e algoritmos
+/// paralelos construídos sobre ele.
+namespace par {
+
+class TaskGroup;
+
+/**
+ * Conjunto de threads em que cada uma tem sua própria fila de tarefas. A dona
+ * da fila empilha e desempilha pelo fim, enquanto threads ociosas roubam pelo
+ * início, pegando as tarefas mais antigas, que costumam ser as maiores.
+ *
+ * A thread que espera um TaskGroup também executa tarefas, então um pool de
+ * n threads cria apenas n - 1 threads auxiliares e, com n igual a 1, todas as
+ * tarefas rodam na thread que chamou wait().
+ */
+class WorkStealingPool {
+ public:
+    explicit WorkStealingPool(uint threads = std::thread::hardware_concurrency()) {
+        threads = std::max(threads, 1u);
+        for (uint i = 0; i + 1 < threads; ++i)
+            this->queues.emplace_back(new Queue());
+        for (uint i = 0; i + 1 < threads; ++i)
+            this->workers.emplace_back(&WorkStealingPool::work, this, i);
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(this->sleep_mutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+        for (std::thread& worker : this->workers)
+            worker.join();
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /// Quantidade de threads que executam tarefas, contando a que espera.
+    uint size() const {
+        return this->workers.size() + 1;
+    }
+
+ private:
+    friend class TaskGroup;
+
+    using Task = std::function<void()>;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    // Fila usada por threads que não pertencem ao pool
+    Queue injector;
+    std::vector<std::thread> workers;
+    std::atomic<size_t> queued{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    // Pool ao qual a thread atual pertence e o índice da sua fila
+    struct Identity {
+        const WorkStealingPool* owner = nullptr;
+        int index = -1;
+    };
+
+    static Identity& identity() {
+        thread_local Identity id;
+        return id;
+    }
+
+    // Índice da fila da thread atual, ou -1 se ela não pertence a este pool
+    int local_index() const {
+        const Identity& id = identity();
+        return id.owner == this ? id.index : -1;
+    }
+
+    void push(Task task) {
+        int index = this->local_index();
+        Queue& queue = index >= 0 ? *this->queues[index] : this->injector;
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        ++this->queued;
+        if (!this->workers.empty()) {
+            // Sincroniza com a thread que está prestes a dormir
+            std::lock_guard<std::mutex> lock(this->sleep_mutex);
+            this->wake.notify_one();
+        }
+    }
+
+    // Tenta executar uma tarefa: primeiro a mais recente da própria fila,
+    // depois a mais antiga da fila de entrada e das filas das outras threads
+    bool run_one() {
+        Task task;
+        int index = this->local_index();
+        if (index >= 0 && this->pop_back(*this->queues[index], task)) {
+            task();
+            return true;
+        }
+        if (this->pop_front(this->injector, task)) {
+            task();
+            return true;
+        }
+        size_t count = this->queues.size();
+        size_t start = index >= 0 ? index + 1 : 0;
+        for (size_t i = 0; i < count; ++i) {
+            size_t victim = (start + i) % count;
+            if (static_cast<int>(victim) != index && this->pop_front(*this->queues[victim], task)) {
+                task();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool pop_back(Queue& queue, Task& task) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        --this->queued;
+        return true;
+    }
+
+    bool pop_front(Queue& queue, Task& task) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        --this->queued;
+        return true;
+    }
+
+    void work(int index) {
+        identity() = Identity{this, index};
+        while (true) {
+            if (this->run_one())
+                continue;
+            std::unique_lock<std::mutex> lock(this->sleep_mutex);
+            this->wake.wait(lock, [this] { return this->stopping || this->queued > 0; });
+            if (this->stopping && this->queued == 0)
+                return;
+        }
+    }
+};
+
+/**
+ * Grupo de tarefas no estilo fork-join: run() enfileira uma tarefa e wait()
+ * executa tarefas do pool até que todas as do grupo terminem. Exceções são
+ * capturadas e a primeira delas é relançada por wait().
+ */
+class TaskGroup {
+ public:
+    explicit TaskGroup(WorkStealingPool& pool) : pool(pool) {}
+
+    ~TaskGroup() {
+        // Tarefas pendentes referenciam o grupo, então ele não pode sumir antes delas
+        while (this->pending > 0) {
+            if (!this->pool.run_one())
+                std::this_thread::yield();
+        }
+    }
+
+    TaskGroup(const TaskGroup&) = delete;
+
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    template<class F>
+    void run(F&& function) {
+        ++this->pending;
+        this->pool.push([this, function = std::forward<F>(function)]() mutable {
+            try {
+                function();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(this->error_mutex);
+                if (!this->error)
+                    this->error = std::current_exception();
+            }
+            --this->pending;
+        });
+    }
+
+    void wait() {
+        while (this->pending > 0) {
+            if (!this->pool.run_one())
+                std::this_thread::yield();
+        }
+        if (this->error) {
+            std::exception_ptr error = this->error;
+            this->error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+ private:
+    WorkStealingPool& pool;
+    std::atomic<size_t> pending{0};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+};
+
+/**
+ * Divide o intervalo [begin, end) em blocos de no mínimo grain elementos e
+ * chama function(inicio, fim) para cada bloco, possivelmente em paralelo.
+ * Intervalos pequenos ou um pool nulo executam tudo na thread atual.
+ */
+template<class F>
+void parallel_for(WorkStealingPool* pool, size_t begin, size_t end, size_t grain, F&& function) {
+    grain = std::max<size_t>(grain, 1);
+    if (!pool || pool->size() == 1 || end - begin <= grain) {
+        if (begin < end)
+            function(begin, end);
+        return;
+    }
+    // Blocos suficientes para balancear a carga sem criar tarefas minúsculas
+    size_t chunks = std::min<size_t>((end - begin + grain - 1) / grain, pool->size() * 8);
+    size_t step = (end - begin + chunks - 1) / chunks;
+    TaskGroup group(*pool);
+    for (size_t first = begin + step; first < end; first += step) {
+        size_t last = std::min(first + step, end);
+        group.run([&function, first, last] { function(first, last); });
+    }
+    function(begin, std::min(begin + step, end));
+    group.wait();
+}
+
+/*
+    Algoritmos sobre subárvores. Funcionam com qualquer nó que tenha os campos
+    m_left, m_right, m_parent e size, como BST::Node. A árvore é dividida em
+    partes: nós grandes (com mais de grain descendentes), tratados pela thread
+    que chama, e subárvores pequenas, que viram tarefas. Como todo nó guarda o
+    tamanho da sua subárvore, a divisão custa apenas O(n / grain).
+*/
+
+/// Parte de uma árvore: um único nó ou uma subárvore inteira.
+template<class Node>
+struct Piece {
+    Node* node;
+    bool whole;
+};
+
+/// Divide a árvore em partes, que saem em ordem simétrica (in-order).
+template<class Node>
+std::vector<Piece<Node>> split_pieces(Node* root, size_t grain) {
+    std::vector<Piece<Node>> pieces;
+    std::vector<Node*> stack;
+    Node* node = root;
+    while (node || !stack.empty()) {
+        while (node && node->size > grain) {
+            stack.push_back(node);
+            node = node->m_left;
+        }
+        if (node)
+            pieces.push_back(Piece<Node>{node, true});
+        if (stack.empty())
+            break;
+        node = stack.back();
+        stack.pop_back();
+        pieces.push_back(Piece<Node>{node, false});
+        node = node->m_right;
+    }
+    return pieces;
+}
+
+/// Tamanho padrão das subárvores de cada tarefa.
+template<class Node>
+size_t default_grain(WorkStealingPool& pool, Node* root) {
+    return std::max<size_t>(root->size / (pool.size() * 8), 1024);
+}
+
+/// Visita os nós em ordem simétrica sem recursão.
+template<class Node, class F>
+void for_each_serial(Node* root, F&& function) {
+    std::vector<Node*> stack;
+    Node* node = root;
+    while (node || !stack.empty()) {
+        while (node) {
+            stack.push_back(node);
+            node = node->m_left;
+        }
+        node = stack.back();
+        stack.pop_back();
+        Node* right = node->m_right;
+        function(node);
+        node = right;
+    }
+}
+
+/// Libera todos os nós sem recursão nem memória extra: rotaciona para a
+/// direita até que o nó atual não tenha filho esquerdo e então o apaga.
+template<class Node>
+void destroy_serial(Node* node) {
+    while (node) {
+        if (node->m_left) {
+            Node* left = node->m_left;
+            node->m_left = left->m_right;
+            left->m_right = node;
+            node = left;
+        } else {
+            Node* right = node->m_right;
+            delete node;
+            node = right;
+        }
+    }
+}
+
+/// Copia a subárvore usando copy(nó), que deve criar um nó sem ligações.
+template<class Node, class Copy>
+Node* clone_serial(const Node* root, Copy& copy) {
+    if (!root)
+        return nullptr;
+    Node* result = copy(root);
+    std::vector<std::pair<const Node*, Node*>> stack{{root, result}};
+    while (!stack.empty()) {
+        const Node* source = stack.back().first;
+        Node* target = stack.back().second;
+        stack.pop_back();
+        if (source->m_left) {
+            target->m_left = copy(source->m_left);
+            target->m_left->m_parent = target;
+            stack.emplace_back(source->m_left, target->m_left);
+        }
+        if (source->m_right) {
+            target->m_right = copy(source->m_right);
+            target->m_right->m_parent = target;
+            stack.emplace_back(source->m_right, target->m_right);
+        }
+    }
+    return result;
+}
+
+/**
+ * Chama function(nó) para cada nó da árvore, em paralelo e sem ordem definida.
+ * A função não deve alterar a estrutura da árvore.
+ */
+template<class Node, class F>
+void parallel_for_each(WorkStealingPool& pool, Node* root, F&& function, size_t grain = 0) {
+    if (!root)
+        return;
+    if (grain == 0)
+        grain = default_grain(pool, root);
+    TaskGroup group(pool);
+    for (const Piece<Node>& piece : split_pieces(root, grain)) {
+        if (piece.whole)
+            group.run([&function, piece] { for_each_serial(piece.node, function); });
+        else
+            function(piece.node);
+    }
+    group.wait();
+}
+
+/**
+ * Reduz a árvore combinando map(nó) de todos os nós em ordem simétrica. Como
+ * as partes são combinadas na ordem das chaves, combine precisa ser apenas
+ * associativa, não comutativa, e identity deve ser seu elemento neutro.
+ */
+template<class T, class Node, class Map, class Combine>
+T parallel_reduce(WorkStealingPool& pool, Node* root, T identity, Map map,
+                  Combine combine, size_t grain = 0) {
+    if (!root)
+        return identity;
+    if (grain == 0)
+        grain = default_grain(pool, root);
+    std::vector<Piece<Node>> pieces = split_pieces(root, grain);
+    std::vector<T> partial(pieces.size(), identity);
+    TaskGroup group(pool);
+    for (size_t i = 0; i < pieces.size(); ++i) {
+        if (pieces[i].whole) {
+            group.run([&, i] {
+                T value = identity;
+                for_each_serial(pieces[i].node, [&](Node* node) {
+                    value = combine(value, map(node));
+                });
+                partial[i] = value;
+            });
+        } else {
+            partial[i] = map(pieces[i].node);
+        }
+    }
+    group.wait();
+    T result = identity;
+    for (const T& value : partial)
+        result = combine(result, value);
+    return result;
+}
+
+/// Libera todos os nós da árvore em paralelo.
+template<class Node>
+void parallel_destroy(WorkStealingPool& pool, Node* root, size_t grain = 0) {
+    if (!root)
+        return;
+    if (grain == 0)
+        grain = default_grain(pool, root);
+    std::vector<Piece<Node>> pieces = split_pieces(root, grain);
+    TaskGroup group(pool);
+    for (const Piece<Node>& piece : pieces) {
+        if (piece.whole)
+            group.run([piece] { destroy_serial(piece.node); });
+    }
+    // Os nós grandes não são acessados pelas tarefas, então já podem ser liberados
+    for (const Piece<Node>& piece : pieces) {
+        if (!piece.whole)
+            delete piece.node;
+    }
+    group.wait();
+}
+
+/// Copia a árvore em paralelo usando copy(nó), que deve criar um nó sem ligações.
+template<class Node, class Copy>
+Node* parallel_clone(WorkStealingPool& pool, const Node* root, Copy copy, size_t grain = 0) {
+    if (!root)
+        return nullptr;
+    if (grain == 0)
+        grain = default_grain(pool, root);
+    if (root->size <= grain)
+        return clone_serial(root, copy);
+    Node* result = copy(root);
+    TaskGroup group(pool);
+    // Copia a parte superior na thread atual e delega as subárvores pequenas
+    std::vector<std::pair<const Node*, Node*>> stack{{root, result}};
+    while (!stack.empty()) {
+        const Node* source = stack.back().first;
+        Node* target = stack.back().second;
+        stack.pop_back();
+        for (int side = 0; side < 2; ++side) {
+            const Node* child = side == 0 ? source->m_left : source->m_right;
+            Node*& slot = side == 0 ? target->m_left : target->m_right;
+            if (!child)
+                continue;
+            if (child->size > grain) {
+                slot = copy(child);
+                slot->m_parent = target;
+                stack.emplace_back(child, slot);
+            } else {
+                group.run([child, &slot, target, &copy] {
+                    slot = clone_serial(child, copy);
+                    slot->m_parent = target;
+                });
+            }
+        }
+    }
+    group.wait();
+    return result;
+}
+
+}  // namespace par
+
+#endif  // PARALLEL_HPP_
@@ -0,0 +1,260 @@
+#ifndef PERSISTENT_HPP_
+#define PERSISTENT_HPP_
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./compare.hpp"
+
+/*
+    Variante persistente da BST: copiar a árvore cria uma nova versão em O(1),
+    que compartilha todos os nós com a original. Uma alteração copia apenas os
+    nós do caminho até a chave que ainda são usados por outra versão, então as
+    versões antigas continuam legíveis e inalteradas, e cada nó é liberado por
+    contagem de referências quando nenhuma versão o usa mais. Sem versões
+    retidas, os nós são alterados no lugar, como na BST. Nós compartilhados não
+    podem ter pai, então não há m_parent.
+
+    Versões diferentes podem ser lidas, alteradas e destruídas em threads
+    diferentes, mas cada versão deve ser usada por uma thread por vez, e a
+    cópia deve ser feita pela thread que altera a versão original.
+*/
+
+template<class K, class V, class Compare = cmp::ThreeWay>
+class PersistentBST {
+ public:
+    using key_type = K;
+    using mapped_type = V;
+    using key_compare = Compare;
+
+    struct Node {
+        Node* m_left;
+        Node* m_right;
+        K m_key;
+        V m_value;
+        uint size;
+        // Versões e nós que apontam para este
+        std::atomic<uint> refs;
+
+        Node(K key, V value)
+            : m_left(nullptr), m_right(nullptr), m_key(std::move(key)),
+              m_value(std::move(value)), size(1), refs(1) {}
+
+        // Cópia que passa a compartilhar os filhos do original
+        Node(const Node& other)
+            : m_left(acquire(other.m_left)), m_right(acquire(other.m_right)), m_key(other.m_key),
+              m_value(other.m_value), size(other.size), refs(1) {}
+
+        // Visualização:
+        const Node* left() const {
+            return this->m_left;
+        }
+
+        const Node* right() const {
+            return this->m_right;
+        }
+
+        K key() const {
+            return this->m_key;
+        }
+
+        V value() const {
+            return this->m_value;
+        }
+    };
+
+    explicit PersistentBST(Compare compare = Compare()) : root(nullptr), compare(compare) {}
+
+    /// Nova versão com o mesmo conteúdo, sem copiar nós.
+    PersistentBST(const PersistentBST& other) : root(acquire(other.root)), compare(other.compare) {}
+
+    PersistentBST(PersistentBST&& other) noexcept : PersistentBST() {
+        this->swap(other);
+    }
+
+    PersistentBST& operator=(PersistentBST other) noexcept {
+        this->swap(other);
+        return *this;
+    }
+
+    void swap(PersistentBST& other) noexcept {
+        std::swap(this->root, other.root);
+        std::swap(this->compare, other.compare);
+    }
+
+    ~PersistentBST() {
+        release(this->root);
+    }
+
+    /// Versão com o estado atual, que não muda com as alterações seguintes.
+    PersistentBST snapshot() const {
+        return *this;
+    }
+
+    size_t size() const {
+        return this->root ? this->root->size : 0;
+    }
+
+    /// Raiz desta versão, que pode ser passada para a Visualization.
+    const Node* get_root() const {
+        return this->root;
+    }
+
+    void clear() {
+        release(this->root);
+        this->root = nullptr;
+    }
+
+    /// Retorna o valor associado à chave ou nullptr se ela não existir.
+    const V* find(const K& key) const {
+        const Node* node = this->find_node(key);
+        return node ? &node->m_value : nullptr;
+    }
+
+    const V& search(const K key) const {
+        const V* value = this->find(key);
+        if (!value) {
+            throw std::invalid_argument("Key" + cmp::describe(key) + " not found.");
+        }
+        return *value;
+    }
+
+    void insert(const K key, const V value) {
+        if (!this->try_insert(key, value)) {
+            throw std::invalid_argument("Can't insert duplicated key" +
+                cmp::describe(key) + ".");
+        }
+    }
+
+    /// Insere a chave se ela ainda não existir e retorna se a inserção aconteceu.
+    bool try_insert(K key, V value) {
+        if (this->find_node(key)) {
+            return false;
+        }
+        Node** link = this->own_path(key, 1);
+        *link = new Node(std::move(key), std::move(value));
+        return true;
+    }
+
+    /// Insere a chave ou, se ela existir, substitui o valor. Retorna se a chave é nova.
+    bool insert_or_assign(K key, V value) {
+        if (!this->find_node(key)) {
+            return this->try_insert(std::move(key), std::move(value));
+        }
+        Node** link = this->own_path(key, 0);
+        (*link)->m_value = std::move(value);
+        return false;
+    }
+
+    /// Remove a chave, se existir.
+    bool erase(const K& key) {
+        if (!this->find_node(key)) {
+            return false;
+        }
+        Node** link = this->own_path(key, -1);
+        Node* node = *link;
+        // Com dois filhos, o sucessor ocupa o lugar do nó e é removido no lugar dele
+        if (node->m_left && node->m_right) {
+            --node->size;
+            Node** next = &node->m_right;
+            Node* successor = own(next);
+            while (successor->m_left) {
+                --successor->size;
+                next = &successor->m_left;
+                successor = own(next);
+            }
+            node->m_key = std::move(successor->m_key);
+            node->m_value = std::move(successor->m_value);
+            link = next;
+            node = successor;
+        }
+        // O nó é exclusivo desta versão, então a referência ao filho passa para o pai
+        *link = node->m_left ? node->m_left : node->m_right;
+        delete node;
+        return true;
+    }
+
+ private:
+    Node* root;
+    Compare compare;
+
+    static Node* acquire(Node* node) {
+        if (node) {
+            node->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        return node;
+    }
+
+    // Solta uma referência e libera, sem recursão, os nós que ficarem sem nenhuma
+    static void release(Node* node) {
+        std::vector<Node*> pending;
+        while (node) {
+            if (node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                if (node->m_left) {
+                    pending.push_back(node->m_left);
+                }
+                if (node->m_right) {
+                    pending.push_back(node->m_right);
+                }
+                delete node;
+            }
+            if (pending.empty()) {
+                break;
+            }
+            node = pending.back();
+            pending.pop_back();
+        }
+    }
+
+    /**
+     * Garante que o nó apontado por link só é usado por esta versão, trocando-o
+     * por uma cópia se for compartilhado. Vale porque o dono de link já é
+     * exclusivo: nenhuma outra versão consegue obter uma nova referência ao nó.
+     */
+    static Node* own(Node** link) {
+        Node* node = *link;
+        if (node->refs.load(std::memory_order_acquire) > 1) {
+            Node* copy = new Node(*node);
+            release(node);
+            *link = copy;
+            return copy;
+        }
+        return node;
+    }
+
+    const Node* find_node(const K& key) const {
+        const Node* node = this->root;
+        while (node) {
+            int order = this->compare(key, node->m_key);
+            if (order == 0) {
+                return node;
+            }
+            node = order < 0 ? node->m_left : node->m_right;
+        }
+        return nullptr;
+    }
+
+    /**
+     * Torna exclusivos desta versão os nós do caminho até a chave, somando
+     * delta ao size dos ancestrais dela. Retorna o campo que aponta para o nó
+     * da chave, ou o campo vazio em que ela deve ser inserida.
+     */
+    Node** own_path(const K& key, int delta) {
+        Node** link = &this->root;
+        while (*link) {
+            Node* node = own(link);
+            int order = this->compare(key, node->m_key);
+            if (order == 0) {
+                break;
+            }
+            node->size += delta;
+            link = order < 0 ? &node->m_left : &node->m_right;
+        }
+        return link;
+    }
+};
+
+#endif  // PERSISTENT_HPP_
@@ -0,0 +1,318 @@
+#ifndef PROFILER_HPP_
+#define PROFILER_HPP_
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace vis {
+
+/**
+ * Mede o tempo gasto em cada etapa da renderização de um frame, tanto na CPU
+ * (com std::chrono) quanto na GPU (com timer queries do OpenGL), mantendo um
+ * histórico dos últimos frames para exibição e, opcionalmente, gravando cada
+ * frame em um arquivo CSV para análise posterior.
+ *
+ * Os resultados da GPU só ficam disponíveis alguns frames depois, então cada
+ * frame fica pendente em um anel de consultas até que todas sejam resolvidas.
+ */
+class FrameProfiler {
+ public:
+    enum Stage : uint {
+        Search,
+        Organize,
+        Upload,
+        Lines,
+        Nodes,
+        Text,
+        Overlay,
+        Capture,
+        Swap,
+        Count
+    };
+
+    /// Tempos de um frame, em milissegundos. GPU negativo indica etapa sem medição.
+    struct Frame {
+        unsigned long index = 0;
+        std::array<double, Stage::Count> cpu{};
+        std::array<double, Stage::Count> gpu{};
+        double total = 0.0;
+    };
+
+    FrameProfiler() = default;
+
+    ~FrameProfiler() {
+        this->release();
+    }
+
+    FrameProfiler(const FrameProfiler&) = delete;
+
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    static const char* name(Stage stage) {
+        static const char* names[Stage::Count] = {
+            "search", "organize", "upload", "lines", "nodes", "text", "overlay", "capture", "swap"
+        };
+        return names[stage];
+    }
+
+    /// Etapas que executam apenas na CPU não recebem timer query.
+    static bool has_gpu_time(Stage stage) {
+        return stage != Stage::Search && stage != Stage::Organize && stage != Stage::Swap;
+    }
+
+    /**
+     * Ativa o profiler. As queries de tempo da GPU só são criadas se a extensão
+     * ARB_timer_query estiver disponível no contexto atual.
+     *
+     * @param csv_path Se não for vazio, cada frame resolvido é gravado neste arquivo.
+     */
+    void enable(const std::string& csv_path = "") {
+        if (!this->enabled) {
+            this->enabled = true;
+            this->use_gpu = GLEW_ARB_timer_query && glfwGetCurrentContext();
+            if (this->use_gpu) {
+                for (auto& slot : this->pending)
+                    glGenQueries(Stage::Count, slot.queries.data());
+            }
+            this->open_frame();
+        }
+        if (!csv_path.empty()) {
+            this->csv.open(csv_path, std::ios::out | std::ios::trunc);
+            if (!this->csv)
+                throw std::runtime_error("Não foi possível abrir " + csv_path + ".");
+            this->csv << "frame";
+            for (uint i = 0; i < Stage::Count; ++i)
+                this->csv << ",cpu_" << name(static_cast<Stage>(i));
+            for (uint i = 0; i < Stage::Count; ++i)
+                this->csv << ",gpu_" << name(static_cast<Stage>(i));
+            this->csv << ",total\n";
+        }
+    }
+
+    void disable() {
+        this->release();
+        this->history.clear();
+        this->history_start = 0;
+    }
+
+    bool is_enabled() const {
+        return this->enabled;
+    }
+
+    /// Inicia a medição de uma etapa do frame atual.
+    void begin(Stage stage) {
+        if (!this->enabled)
+            return;
+        Slot& slot = this->pending[this->current];
+        slot.stage_start[stage] = clock::now();
+        if (this->use_gpu && has_gpu_time(stage)) {
+            glBeginQuery(GL_TIME_ELAPSED, slot.queries[stage]);
+            slot.issued[stage] = true;
+        }
+    }
+
+    /// Encerra a medição de uma etapa, acumulando caso ela se repita no frame.
+    void end(Stage stage) {
+        if (!this->enabled)
+            return;
+        Slot& slot = this->pending[this->current];
+        if (this->use_gpu && slot.issued[stage])
+            glEndQuery(GL_TIME_ELAPSED);
+        slot.frame.cpu[stage] += std::chrono::duration<double, std::milli>(
+            clock::now() - slot.stage_start[stage]).count();
+    }
+
+    /// Objeto que mede uma etapa enquanto estiver no escopo.
+    class Scope {
+     public:
+        Scope(FrameProfiler& profiler, Stage stage) : profiler(profiler), stage(stage) {
+            this->profiler.begin(stage);
+        }
+
+        ~Scope() {
+            this->profiler.end(this->stage);
+        }
+
+     private:
+        FrameProfiler& profiler;
+        Stage stage;
+    };
+
+    Scope scope(Stage stage) {
+        return Scope(*this, stage);
+    }
+
+    /// Fecha o frame atual e tenta resolver as consultas de frames anteriores.
+    void end_frame() {
+        if (!this->enabled)
+            return;
+        Slot& slot = this->pending[this->current];
+        slot.frame.total = std::chrono::duration<double, std::milli>(
+            clock::now() - slot.frame_start).count();
+        slot.in_use = true;
+        this->current = (this->current + 1) % latency;
+        // Se o anel deu a volta, o frame mais antigo precisa ser resolvido agora
+        if (this->pending[this->current].in_use)
+            this->resolve(this->pending[this->current], true);
+        for (uint i = 1; i < latency; ++i) {
+            Slot& older = this->pending[(this->current + i) % latency];
+            if (older.in_use && !this->resolve(older, false))
+                break;
+        }
+        this->open_frame();
+    }
+
+    /// Média de cada etapa nos frames do histórico.
+    Frame average() const {
+        Frame result;
+        if (this->history.empty())
+            return result;
+        for (const Frame& frame : this->history) {
+            for (uint i = 0; i < Stage::Count; ++i) {
+                result.cpu[i] += frame.cpu[i];
+                result.gpu[i] += frame.gpu[i];
+            }
+            result.total += frame.total;
+        }
+        for (uint i = 0; i < Stage::Count; ++i) {
+            result.cpu[i] /= this->history.size();
+            result.gpu[i] /= this->history.size();
+        }
+        result.total /= this->history.size();
+        result.index = this->history.size();
+        return result;
+    }
+
+    /// Linhas de texto com a média recente de cada etapa, usadas pelo overlay.
+    std::vector<std::string> report() const {
+        std::vector<std::string> lines;
+        Frame avg = this->average();
+        char line[64];
+        for (uint i = 0; i < Stage::Count; ++i) {
+            if (avg.gpu[i] >= 0.0 && has_gpu_time(static_cast<Stage>(i))) {
+                std::snprintf(line, sizeof(line), "%-8s %7.3f %7.3f",
+                    name(static_cast<Stage>(i)), avg.cpu[i], avg.gpu[i]);
+            } else {
+                std::snprintf(line, sizeof(line), "%-8s %7.3f       -",
+                    name(static_cast<Stage>(i)), avg.cpu[i]);
+            }
+            lines.emplace_back(line);
+        }
+        std::snprintf(line, sizeof(line), "%-8s %7.3f", "frame", avg.total);
+        lines.emplace_back(line);
+        return lines;
+    }
+
+    /// Quantidade de frames mantidos no histórico usado pela média.
+    static constexpr uint history_size = 120;
+
+ private:
+    using clock = std::chrono::steady_clock;
+
+    // Quantidade de frames que podem aguardar o resultado da GPU simultaneamente
+    static constexpr uint latency = 4;
+
+    struct Slot {
+        Frame frame;
+        clock::time_point frame_start;
+        std::array<clock::time_point, Stage::Count> stage_start;
+        std::array<GLuint, Stage::Count> queries{};
+        std::array<bool, Stage::Count> issued{};
+        bool in_use = false;
+    };
+
+    std::array<Slot, latency> pending;
+    std::vector<Frame> history;
+    uint history_start = 0;
+    uint current = 0;
+    unsigned long frame_count = 0;
+    std::ofstream csv;
+    bool enabled = false;
+    bool use_gpu = false;
+
+    void open_frame() {
+        Slot& slot = this->pending[this->current];
+        slot.frame = Frame{};
+        slot.frame.index = this->frame_count++;
+        for (uint i = 0; i < Stage::Count; ++i) {
+            bool measured = this->use_gpu && has_gpu_time(static_cast<Stage>(i));
+            slot.frame.gpu[i] = measured ? 0.0 : -1.0;
+        }
+        slot.issued.fill(false);
+        slot.frame_start = clock::now();
+    }
+
+    // Lê os resultados da GPU de um frame. Se wait for falso e algum resultado
+    // ainda não estiver disponível, retorna falso sem bloquear.
+    bool resolve(Slot& slot, bool wait) {
+        if (this->use_gpu) {
+            for (uint i = 0; i < Stage::Count; ++i) {
+                if (!slot.issued[i])
+                    continue;
+                GLint available = 0;
+                glGetQueryObjectiv(slot.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available && !wait)
+                    return false;
+            }
+            for (uint i = 0; i < Stage::Count; ++i) {
+                if (!slot.issued[i])
+                    continue;
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &elapsed);
+                slot.frame.gpu[i] = elapsed / 1e6;
+            }
+        }
+        slot.in_use = false;
+        this->record(slot.frame);
+        return true;
+    }
+
+    void record(const Frame& frame) {
+        if (this->history.size() < history_size) {
+            this->history.push_back(frame);
+        } else {
+            this->history[this->history_start] = frame;
+            this->history_start = (this->history_start + 1) % history_size;
+        }
+        if (this->csv.is_open()) {
+            this->csv << frame.index;
+            for (double t : frame.cpu)
+                this->csv << ',' << t;
+            for (double t : frame.gpu)
+                this->csv << ',' << (t < 0.0 ? 0.0 : t);
+            this->csv << ',' << frame.total << '\n';
+        }
+    }
+
+    void release() {
+        if (!this->enabled)
+            return;
+        // Resolve o que ainda estiver pendente para não perder as últimas linhas do CSV
+        for (uint i = 1; i <= latency; ++i) {
+            Slot& slot = this->pending[(this->current + i) % latency];
+            if (slot.in_use && (!this->use_gpu || glfwGetCurrentContext()))
+                this->resolve(slot, true);
+        }
+        if (this->use_gpu && glfwGetCurrentContext()) {
+            for (auto& slot : this->pending)
+                glDeleteQueries(Stage::Count, slot.queries.data());
+        }
+        if (this->csv.is_open())
+            this->csv.close();
+        this->enabled = false;
+        this->use_gpu = false;
+    }
+};
+
+}  // namespace vis
+
+#endif  // PROFILER_HPP_
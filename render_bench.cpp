@@ -0,0 +1,60 @@
+#include "./BST.hpp"
+#include "./vis.hpp"
+
+#include <numeric>
+
+/*
+    Mede o custo de cada etapa do desenho de uma árvore balanceada com n nós,
+    usando o profiler da Visualization, com um frame por chamada de draw no
+    modo estático. Com muitos nós, cada um ocupa poucos pixels e domina o
+    custo por vértice; com poucos, os nós são grandes e domina o
+    preenchimento. Para medir em um rasterizador por software (llvmpipe):
+        LIBGL_ALWAYS_SOFTWARE=1 ./render_bench [n] [frames]
+    Com um destino de captura (ver Visualization::enable_capture), os frames
+    são desenhados de novo gravando a janela, para comparar os tempos:
+        ./render_bench 100000 200 frames.rgba
+        ./render_bench 100000 200 "| ffmpeg -f rawvideo -pix_fmt rgba -s 1280x720 -i - out.mp4"
+*/
+
+using Tree = BST<int, int>;
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::stoull(argv[1]) : 100000;
+    int frames = argc > 2 ? std::stoi(argv[2]) : 50;
+    std::vector<int> keys(n);
+    std::iota(keys.begin(), keys.end(), 0);
+    Tree tree;
+    tree.build_sorted(keys.data(), keys.data(), n);
+
+    Visualization<Tree::Node*> system(tree.get_root(), false, 1280, 720);
+    auto run = [&] {
+        system.enable_profiling(false);
+        for (int i = 0; i < frames; ++i) {
+            if (!system.draw(0.001, true))
+                break;
+        }
+        const vis::FrameProfiler& profiler = system.get_profiler();
+        vis::FrameProfiler::Frame average = profiler.average();
+        std::cout << "n=" << n << ", " << average.index << " frames, média em ms:" << std::endl;
+        std::cout << "stage      cpu     gpu" << std::endl;
+        for (const std::string& line : profiler.report())
+            std::cout << line << std::endl;
+        double nodes = average.gpu[vis::FrameProfiler::Stage::Nodes];
+        if (nodes >= 0.0)
+            std::cout << "nós: " << nodes * 1e6 / n << " ns de GPU por nó" << std::endl;
+        // Recomeça o histórico do profiler
+        system.disable_profiling();
+    };
+    run();
+
+    if (argc > 3) {
+        std::cout << std::endl << "com captura:" << std::endl;
+        system.enable_capture(argv[3]);
+        run();
+        system.disable_capture();
+        const vis::FrameCapture& capture = system.get_capture();
+        std::cout << capture.written() << " frames gravados, " << capture.dropped()
+                  << " descartados" << std::endl;
+    }
+    return 0;
+}
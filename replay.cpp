@@ -0,0 +1,62 @@
+#include "./BST.hpp"
+#include "./trace.hpp"
+#include "./vis.hpp"
+
+#include <cstring>
+
+/*
+    Reproduz um arquivo de trace salvo com trace::Recorder::dump, de uma
+    BST<int, int>, exibindo a árvore antes de cada evento. ENTER avança para o
+    próximo estado. Com --print, os estados são apenas impressos no terminal.
+        ./replay trace.bin [primeiro estado] [passo] [--print]
+*/
+
+using Tree = BST<int, int>;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Uso: " << argv[0] << " trace.bin [primeiro] [passo] [--print]" << std::endl;
+        return 1;
+    }
+    bool print = false;
+    std::vector<uint64_t> numbers;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--print") == 0)
+            print = true;
+        else
+            numbers.push_back(std::stoull(argv[i]));
+    }
+
+    trace::Replayer<Tree> replayer = trace::Replayer<Tree>::load(argv[1]);
+    uint64_t first = numbers.size() > 0 ? numbers[0] : replayer.first();
+    uint64_t step = numbers.size() > 1 ? std::max<uint64_t>(numbers[1], 1) : 1;
+    uint64_t last = replayer.last();
+    std::cout << "Estados " << replayer.first() << " a " << last << std::endl;
+
+    std::unique_ptr<Visualization<Tree::Node*>> system;
+    for (uint64_t sequence = first; sequence <= last; sequence += step) {
+        Tree tree;
+        replayer.state_at(sequence, tree);
+        const auto& events = replayer.get_events();
+        auto next = std::lower_bound(events.begin(), events.end(), sequence,
+            [](const trace::Event<int, int>& e, uint64_t s) { return e.sequence < s; });
+        std::cout << "Estado " << sequence;
+        if (next != events.end())
+            std::cout << ", próximo evento: " << trace::name(next->op) << " " << next->key;
+        std::cout << std::endl;
+
+        if (print) {
+            tree.print();
+            continue;
+        }
+        if (!tree.get_root())
+            continue;
+        if (!system)
+            system.reset(new Visualization<Tree::Node*>(tree.get_root(), false, 1280, 720));
+        else
+            system->set_root(tree.get_root());
+        if (!system->draw(0.0, true))
+            break;
+    }
+    return 0;
+}
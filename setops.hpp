@@ -0,0 +1,266 @@
+#ifndef SETOPS_HPP_
+#define SETOPS_HPP_
+
+#include <cstddef>
+#include <tuple>
+
+#include "./augment.hpp"
+#include "./parallel.hpp"
+
+/*
+    Operações baseadas em join para árvores com os campos de BST::Node
+    (m_left, m_right, m_parent, size e, se houver, m_hash e m_aggregate). O join une duas
+    árvores e um nó pivô mantendo o balanceamento por peso (o tamanho de cada
+    lado fica entre 29% e 71% do total), e split, união, interseção e
+    diferença são construídos sobre ele, como em "Just Join for Parallel
+    Ordered Sets" (Blelloch et al.). Com árvores balanceadas, join e split
+    levam O(log n), e as operações de conjunto processam as duas metades de
+    cada chamada em paralelo. Árvores desbalanceadas dão resultados
+    corretos, mas a recursão segue a altura delas, então árvores degeneradas
+    devem passar antes por BST::rebalance.
+
+    Todas as funções consomem as árvores recebidas e retornam raízes sem pai.
+*/
+
+namespace setops {
+
+constexpr double alpha = 0.29;
+
+template<class Node>
+size_t size_of(const Node* node) {
+    return node ? node->size : 0;
+}
+
+template<class Node>
+Node* detach(Node* node) {
+    if (node)
+        node->m_parent = nullptr;
+    return node;
+}
+
+// Compara os pesos (tamanho + 1) de dois lados de um nó
+inline bool balanced(size_t left, size_t right) {
+    double total = static_cast<double>(left + right);
+    return alpha * total <= left && alpha * total <= right;
+}
+
+template<class Node>
+bool balanced(const Node* left, const Node* right) {
+    return balanced(size_of(left) + 1, size_of(right) + 1);
+}
+
+template<class Node>
+Node* make(Node* left, Node* node, Node* right) {
+    node->m_left = left;
+    node->m_right = right;
+    node->m_parent = nullptr;
+    if (left)
+        left->m_parent = node;
+    if (right)
+        right->m_parent = node;
+    augment::update(node);
+    return node;
+}
+
+template<class Node>
+Node* rotate_left(Node* node) {
+    Node* right = node->m_right;
+    return make(make(node->m_left, node, right->m_left), right, right->m_right);
+}
+
+template<class Node>
+Node* rotate_right(Node* node) {
+    Node* left = node->m_left;
+    return make(left->m_left, left, make(left->m_right, node, node->m_right));
+}
+
+template<class Node>
+Node* join_left(Node* left, Node* pivot, Node* right);
+
+// Desce pela borda direita de left, que é mais pesada, até achar onde right cabe
+template<class Node>
+Node* join_right(Node* left, Node* pivot, Node* right) {
+    if (balanced(left, right))
+        return make(left, pivot, right);
+    // Em entradas desbalanceadas, a borda pode acabar antes de right caber
+    if (!left)
+        return join_left(left, pivot, right);
+    Node* outer = left->m_left;
+    Node* joined = join_right(left->m_right, pivot, right);
+    if (balanced(outer, joined))
+        return make(outer, left, joined);
+    // Árvores de entrada desbalanceadas podem não ter o neto da rotação dupla
+    if (!joined->m_left || (balanced(outer, joined->m_left) &&
+        balanced(size_of(outer) + size_of(joined->m_left) + 2, size_of(joined->m_right) + 1)))
+        return rotate_left(make(outer, left, joined));
+    return rotate_left(make(outer, left, rotate_right(joined)));
+}
+
+template<class Node>
+Node* join_left(Node* left, Node* pivot, Node* right) {
+    if (balanced(left, right))
+        return make(left, pivot, right);
+    if (!right)
+        return join_right(left, pivot, right);
+    Node* outer = right->m_right;
+    Node* joined = join_left(left, pivot, right->m_left);
+    if (balanced(joined, outer))
+        return make(joined, right, outer);
+    if (!joined->m_right || (balanced(joined->m_right, outer) &&
+        balanced(size_of(joined->m_left) + 1, size_of(joined->m_right) + size_of(outer) + 2)))
+        return rotate_right(make(joined, right, outer));
+    return rotate_right(make(rotate_left(joined), right, outer));
+}
+
+/// Une left, pivot e right, em que todas as chaves de left < pivot < right.
+template<class Node>
+Node* join(Node* left, Node* pivot, Node* right) {
+    if (size_of(left) > size_of(right))
+        return join_right(left, pivot, right);
+    return join_left(left, pivot, right);
+}
+
+/// Separa o maior nó de root, retornando a árvore restante e o nó.
+template<class Node>
+std::pair<Node*, Node*> split_last(Node* root) {
+    Node* right = root->m_right;
+    if (!right)
+        return {detach(root->m_left), root};
+    Node* left = detach(root->m_left);
+    std::pair<Node*, Node*> rest = split_last(detach(right));
+    return {join(left, root, rest.first), rest.second};
+}
+
+/// Une duas árvores em que todas as chaves de left < right.
+template<class Node>
+Node* join2(Node* left, Node* right) {
+    if (!left)
+        return right;
+    if (right)
+        right->m_parent = nullptr;
+    std::pair<Node*, Node*> last = split_last(left);
+    return join(last.first, last.second, right);
+}
+
+/**
+ * Divide root em nós menores e maiores que uma chave, descrita por
+ * order(nó), que retorna a comparação da chave com o nó. O nó com a chave,
+ * se existir, é retornado separado.
+ */
+template<class Node, class Order>
+std::tuple<Node*, Node*, Node*> split(Node* root, const Order& order) {
+    if (!root)
+        return {nullptr, nullptr, nullptr};
+    Node* left = detach(root->m_left);
+    Node* right = detach(root->m_right);
+    int result = order(root);
+    if (result == 0) {
+        root->m_left = root->m_right = nullptr;
+        augment::update(root);
+        return {left, root, right};
+    }
+    if (result < 0) {
+        auto [less, found, greater] = split(left, order);
+        return {less, found, join(greater, root, right)};
+    }
+    auto [less, found, greater] = split(right, order);
+    return {join(left, root, less), found, greater};
+}
+
+// Executa as duas metades em paralelo se forem grandes o bastante
+template<class Left, class Right>
+void fork(par::WorkStealingPool* pool, size_t work, size_t grain, Left&& left, Right&& right) {
+    if (pool && pool->size() > 1 && work > grain) {
+        par::TaskGroup group(*pool);
+        group.run(left);
+        right();
+        group.wait();
+    } else {
+        left();
+        right();
+    }
+}
+
+/**
+ * Parâmetros comuns das operações de conjunto: compare(a, b) compara as
+ * chaves de dois nós, e subárvores somando mais que grain nós são divididas
+ * em tarefas do pool.
+ */
+template<class Compare>
+struct Context {
+    Compare compare;
+    par::WorkStealingPool* pool;
+    size_t grain;
+};
+
+/// União; quando a chave está nas duas árvores, fica o nó de b.
+template<class Node, class Compare>
+Node* unite(Node* a, Node* b, const Context<Compare>& context) {
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+    size_t work = a->size + b->size;
+    Node* b_left = detach(b->m_left);
+    Node* b_right = detach(b->m_right);
+    auto [a_left, found, a_right] = split(a, [&](const Node* node) {
+        return context.compare(b, node);
+    });
+    delete found;
+    Node* left;
+    Node* right;
+    fork(context.pool, work, context.grain,
+        [&, a_left = a_left] { left = unite(a_left, b_left, context); },
+        [&, a_right = a_right] { right = unite(a_right, b_right, context); });
+    return join(left, b, right);
+}
+
+/// Interseção; ficam os nós de a.
+template<class Node, class Compare>
+Node* intersect(Node* a, Node* b, const Context<Compare>& context) {
+    if (!a || !b) {
+        par::destroy_serial(a);
+        par::destroy_serial(b);
+        return nullptr;
+    }
+    size_t work = a->size + b->size;
+    Node* b_left = detach(b->m_left);
+    Node* b_right = detach(b->m_right);
+    auto [a_left, found, a_right] = split(a, [&](const Node* node) {
+        return context.compare(b, node);
+    });
+    delete b;
+    Node* left;
+    Node* right;
+    fork(context.pool, work, context.grain,
+        [&, a_left = a_left] { left = intersect(a_left, b_left, context); },
+        [&, a_right = a_right] { right = intersect(a_right, b_right, context); });
+    return found ? join(left, found, right) : join2(left, right);
+}
+
+/// Diferença: nós de a cujas chaves não estão em b.
+template<class Node, class Compare>
+Node* subtract(Node* a, Node* b, const Context<Compare>& context) {
+    if (!a || !b) {
+        par::destroy_serial(b);
+        return a;
+    }
+    size_t work = a->size + b->size;
+    Node* b_left = detach(b->m_left);
+    Node* b_right = detach(b->m_right);
+    auto [a_left, found, a_right] = split(a, [&](const Node* node) {
+        return context.compare(b, node);
+    });
+    delete found;
+    delete b;
+    Node* left;
+    Node* right;
+    fork(context.pool, work, context.grain,
+        [&, a_left = a_left] { left = subtract(a_left, b_left, context); },
+        [&, a_right = a_right] { right = subtract(a_right, b_right, context); });
+    return join2(left, right);
+}
+
+}  // namespace setops
+
+#endif  // SETOPS_HPP_
@@ -0,0 +1,504 @@
+#ifndef SHARDED_BST_HPP_
+#define SHARDED_BST_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "./BST.hpp"
+
+/*
+    Floresta de BSTs independentes, cada uma com um intervalo de chaves, para
+    que inserções de threads diferentes não disputem a mesma raiz. A árvore i
+    guarda as chaves em [bounds[i - 1], bounds[i]), e cada uma tem seu próprio
+    mutex; os limites são protegidos por um shared_mutex, que só é tomado com
+    exclusividade para redistribuí-los.
+
+    Lotes ordenados são divididos por busca binária nos limites e cada parte
+    é unida à sua árvore com set_union, uma tarefa por árvore. Quando a maior
+    árvore passa de skew_limit vezes a média, as árvores são unidas com join
+    e divididas de novo em tamanhos iguais, escolhendo os cortes pelo campo
+    size, em O(árvores × altura). Como os intervalos são disjuntos e
+    ordenados, a iteração em ordem só percorre as árvores uma após a outra.
+
+    join, split e set_union são recursivos e descem pela altura das árvores,
+    mas inserções individuais podem degenerar uma árvore, como com chaves
+    em ordem. Cada árvore guarda a maior profundidade alcançada por essas
+    inserções, e as que passam de 2·log2(tamanho) são balanceadas com
+    BST::rebalance antes dessas operações.
+*/
+
+template<class K, class V, class Compare = cmp::ThreeWay>
+class ShardedBST {
+ public:
+    using key_type = K;
+    using mapped_type = V;
+    using Tree = BST<K, V, Compare>;
+    using Node = typename Tree::Node;
+
+    /**
+     * Nó de uma visão da floresta para a Visualization. As árvores aparecem
+     * como folhas de uma árvore balanceada de nós de corte, cuja chave é o
+     * limite entre as árvores à esquerda e à direita, então a visão inteira
+     * também é uma árvore de busca. Não há locks: a floresta não deve ser
+     * alterada enquanto é desenhada.
+     */
+    class NodeView {
+     public:
+        // Tamanho da subárvore, contando os nós de corte, lido por
+        // layout::known_size e pelas estatísticas
+        size_t size = 0;
+
+        NodeView() = default;
+
+        const NodeView* operator->() const {
+            return this;
+        }
+
+        explicit operator bool() const {
+            return this->node || this->is_router();
+        }
+
+        bool operator==(const NodeView& other) const {
+            return this->forest == other.forest && this->node == other.node &&
+                this->lo == other.lo && this->hi == other.hi;
+        }
+
+        bool operator!=(const NodeView& other) const {
+            return !(*this == other);
+        }
+
+        // Visualização:
+        NodeView left() const {
+            if (this->is_router())
+                return range(this->forest, this->lo, this->middle());
+            return NodeView(this->forest, this->node->m_left);
+        }
+
+        NodeView right() const {
+            if (this->is_router())
+                return range(this->forest, this->middle(), this->hi);
+            return NodeView(this->forest, this->node->m_right);
+        }
+
+        K key() const {
+            return this->is_router() ? this->forest->bounds[this->middle() - 1] : this->node->m_key;
+        }
+
+        /// Nó de corte entre árvores, que não guarda uma chave da floresta.
+        bool is_router() const {
+            return this->hi - this->lo >= 2;
+        }
+
+        /// Nó real de uma das árvores, ou nulo em nós de corte.
+        const Node* get() const {
+            return this->node;
+        }
+
+     private:
+        friend class ShardedBST;
+
+        const ShardedBST* forest = nullptr;
+        const Node* node = nullptr;
+        // Árvores cobertas por um nó de corte
+        size_t lo = 0;
+        size_t hi = 0;
+
+        NodeView(const ShardedBST* forest, const Node* node)
+            : size(node ? node->size : 0), forest(forest), node(node) {}
+
+        size_t middle() const {
+            return (this->lo + this->hi) / 2;
+        }
+
+        static NodeView range(const ShardedBST* forest, size_t lo, size_t hi) {
+            if (hi - lo == 1)
+                return NodeView(forest, forest->shards[lo]->tree.get_root());
+            NodeView view;
+            view.forest = forest;
+            view.lo = lo;
+            view.hi = hi;
+            view.size = hi - lo - 1;
+            for (size_t i = lo; i < hi; ++i)
+                view.size += shard_size(forest->shards[i]->tree);
+            return view;
+        }
+    };
+
+    /// Iterador em ordem pela floresta inteira, de uma árvore para a seguinte.
+    class const_iterator {
+     public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Node;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Node*;
+        using reference = const Node&;
+
+        const_iterator() = default;
+
+        const Node& operator*() const {
+            return *this->position;
+        }
+
+        const Node* operator->() const {
+            return this->position.get();
+        }
+
+        const_iterator& operator++() {
+            ++this->position;
+            this->skip_empty();
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return this->shard == other.shard && this->position == other.position;
+        }
+
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+
+     private:
+        friend class ShardedBST;
+
+        const ShardedBST* forest = nullptr;
+        size_t shard = 0;
+        typename Tree::const_iterator position;
+
+        const_iterator(const ShardedBST* forest, size_t shard, typename Tree::const_iterator position)
+            : forest(forest), shard(shard), position(position) {}
+
+        // Ao fim de uma árvore, passa para a primeira da seguinte que não está vazia
+        void skip_empty() {
+            while (!this->position.get() && this->shard + 1 < this->forest->shards.size()) {
+                ++this->shard;
+                this->position = this->forest->shards[this->shard]->tree.begin();
+            }
+        }
+    };
+
+    /**
+     * Cria uma floresta de count árvores vazias. Até o primeiro lote, todas
+     * as chaves vão para a primeira árvore; o primeiro lote com pelo menos
+     * count chaves define os limites pelos seus quantis.
+     */
+    explicit ShardedBST(size_t count = std::thread::hardware_concurrency(), Compare compare = Compare())
+        : compare(compare) {
+        count = std::max<size_t>(count, 1);
+        for (size_t i = 0; i < count; ++i)
+            this->shards.emplace_back(new Shard(compare));
+    }
+
+    ShardedBST(const ShardedBST&) = delete;
+
+    ShardedBST& operator=(const ShardedBST&) = delete;
+
+    size_t shard_count() const {
+        return this->shards.size();
+    }
+
+    /// Árvore i. Não é sincronizada com inserções concorrentes.
+    const Tree& shard(size_t i) const {
+        return this->shards.at(i)->tree;
+    }
+
+    /// Primeira chave de cada árvore a partir da segunda; vazio até o primeiro lote.
+    const std::vector<K>& get_bounds() const {
+        return this->bounds;
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(this->layout_mutex);
+        size_t total = 0;
+        for (const auto& shard : this->shards) {
+            std::lock_guard<std::mutex> shard_lock(shard->mutex);
+            total += shard_size(shard->tree);
+        }
+        return total;
+    }
+
+    /// Tamanho da maior árvore dividido pela média; 1 é o equilíbrio perfeito.
+    double skew() const {
+        std::shared_lock<std::shared_mutex> lock(this->layout_mutex);
+        size_t total = 0, largest = 0;
+        for (const auto& shard : this->shards) {
+            std::lock_guard<std::mutex> shard_lock(shard->mutex);
+            size_t size = shard_size(shard->tree);
+            total += size;
+            largest = std::max(largest, size);
+        }
+        return total ? static_cast<double>(largest) * this->shards.size() / total : 1.0;
+    }
+
+    /**
+     * Redistribui as chaves sozinho ao fim de insert_batch quando skew passa
+     * de limit. Com 0, só rebalance_shards redistribui.
+     */
+    void set_skew_limit(double limit) {
+        this->skew_limit = limit;
+    }
+
+    // As operações com uma chave podem ser chamadas de várias threads ao mesmo
+    // tempo e só disputam o lock da árvore da chave.
+
+    void insert(const K key, const V value) {
+        this->with_shard(key, [&](Shard& shard) {
+            auto [it, inserted] = shard.tree.try_insert(key, value);
+            if (!inserted)
+                throw std::invalid_argument("Can't insert duplicated key" + cmp::describe(key) + ".");
+            shard.reached(it.get());
+        });
+    }
+
+    /// Insere a chave ou substitui o valor. Retorna se a chave era nova.
+    bool insert_or_assign(const K key, const V value) {
+        return this->with_shard(key, [&](Shard& shard) {
+            auto [it, inserted] = shard.tree.insert_or_assign(key, value);
+            if (inserted)
+                shard.reached(it.get());
+            return inserted;
+        });
+    }
+
+    bool erase(const K& key) {
+        return this->with_shard(key, [&](Shard& shard) {
+            return shard.tree.erase(key);
+        });
+    }
+
+    bool contains(const K& key) const {
+        return const_cast<ShardedBST*>(this)->with_shard(key, [&](Shard& shard) {
+            return shard.tree.find(key) != shard.tree.end();
+        });
+    }
+
+    /// Cópia do valor da chave, já que a referência não seria protegida pelo lock.
+    V search(const K& key) const {
+        return const_cast<ShardedBST*>(this)->with_shard(key, [&](Shard& shard) {
+            return shard.tree.search(key);
+        });
+    }
+
+    /**
+     * Adiciona um lote de chaves em ordem crescente e sem repetição. O lote é
+     * dividido pelos limites e cada parte é unida à sua árvore com
+     * set_union, em paralelo se um pool for dado; chaves que já existem têm
+     * o valor substituído. Depois, redistribui as chaves se a floresta
+     * passou do limite de desequilíbrio.
+     */
+    void insert_batch(const K* keys, const V* values, size_t count, par::WorkStealingPool* pool = nullptr) {
+        for (size_t i = 1; i < count; ++i) {
+            if (this->compare(keys[i - 1], keys[i]) >= 0)
+                throw std::invalid_argument("Batch keys must be sorted and unique.");
+        }
+        if (count == 0)
+            return;
+        bool routed = false;
+        {
+            std::shared_lock<std::shared_mutex> lock(this->layout_mutex);
+            if (!this->bounds.empty() || this->shards.size() == 1) {
+                this->route(keys, values, count, pool);
+                routed = true;
+            }
+        }
+        if (!routed) {
+            std::unique_lock<std::shared_mutex> lock(this->layout_mutex);
+            // Outra thread pode ter definido os limites enquanto o lock estava livre
+            if (this->bounds.empty() && count >= this->shards.size() && this->total_unlocked() == 0) {
+                for (size_t i = 1; i < this->shards.size(); ++i)
+                    this->bounds.push_back(keys[i * count / this->shards.size()]);
+            }
+            this->route(keys, values, count, pool);
+        }
+        if (this->skew_limit > 0 && this->skew() > this->skew_limit)
+            this->rebalance_shards();
+    }
+
+    /**
+     * Une todas as árvores e as divide de novo em partes de mesmo tamanho,
+     * com cortes escolhidos pelo campo size. Bloqueia todas as outras
+     * operações enquanto executa.
+     */
+    void rebalance_shards() {
+        std::unique_lock<std::shared_mutex> lock(this->layout_mutex);
+        const size_t count = this->shards.size();
+        const size_t total = this->total_unlocked();
+        if (count == 1 || total < count)
+            return;
+        for (auto& shard : this->shards)
+            shard->balance();
+        Tree all = std::move(this->shards[0]->tree);
+        for (size_t i = 1; i < count; ++i)
+            all = Tree::join(std::move(all), std::move(this->shards[i]->tree));
+        this->bounds.assign(count - 1, K());
+        // Corta do fim para o início, para que as posições do que resta não mudem
+        for (size_t i = count - 1; i > 0; --i) {
+            this->bounds[i - 1] = key_at(all.get_root(), i * total / count);
+            this->shards[i]->tree = all.split(this->bounds[i - 1]);
+            this->shards[i]->depth = 0;
+        }
+        this->shards[0]->tree = std::move(all);
+        this->shards[0]->depth = 0;
+    }
+
+    // Iteração em ordem; não é sincronizada com inserções concorrentes
+    const_iterator begin() const {
+        const_iterator it(this, 0, this->shards[0]->tree.begin());
+        it.skip_empty();
+        return it;
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, this->shards.size() - 1, typename Tree::const_iterator());
+    }
+
+    /// Raiz da visão de toda a floresta, com nós de corte acima das árvores.
+    NodeView overview() const {
+        return NodeView::range(this, 0, this->shards.size());
+    }
+
+    /// Raiz da árvore i, no mesmo tipo de overview.
+    NodeView shard_root(size_t i) const {
+        return NodeView(this, this->shards.at(i)->tree.get_root());
+    }
+
+    /// Nós de corte da visão, para destacar com Visualization::set_highlight.
+    std::vector<NodeView> routers() const {
+        std::vector<NodeView> result;
+        std::vector<NodeView> stack{this->overview()};
+        while (!stack.empty()) {
+            NodeView view = stack.back();
+            stack.pop_back();
+            if (!view.is_router())
+                continue;
+            result.push_back(view);
+            stack.push_back(view.left());
+            stack.push_back(view.right());
+        }
+        return result;
+    }
+
+ private:
+    struct Shard {
+        explicit Shard(Compare compare) : tree(compare) {}
+
+        mutable std::mutex mutex;
+        Tree tree;
+        // Maior profundidade alcançada por inserções individuais desde que a
+        // árvore foi balanceada ou montada por join e split
+        size_t depth = 0;
+
+        void reached(const Node* node) {
+            size_t depth = 0;
+            for (; node->m_parent; node = node->m_parent)
+                ++depth;
+            this->depth = std::max(this->depth, depth);
+        }
+
+        // Evita que as operações recursivas desçam por um caminho degenerado
+        void balance() {
+            if (this->depth > 2 * std::log2(shard_size(this->tree) + 1.0)) {
+                this->tree.rebalance();
+                this->depth = 0;
+            }
+        }
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<K> bounds;
+    mutable std::shared_mutex layout_mutex;
+    Compare compare;
+    double skew_limit = 2.0;
+
+    static size_t shard_size(const Tree& tree) {
+        return tree.get_root() ? tree.get_root()->size : 0;
+    }
+
+    // Chave na posição rank (a partir de 0) da ordem, descendo pelos tamanhos
+    static const K& key_at(const Node* node, size_t rank) {
+        while (true) {
+            size_t left = node->m_left ? node->m_left->size : 0;
+            if (rank == left)
+                return node->m_key;
+            if (rank < left) {
+                node = node->m_left;
+            } else {
+                rank -= left + 1;
+                node = node->m_right;
+            }
+        }
+    }
+
+    // Espera que layout_mutex esteja bloqueado com exclusividade
+    size_t total_unlocked() const {
+        size_t total = 0;
+        for (const auto& shard : this->shards)
+            total += shard_size(shard->tree);
+        return total;
+    }
+
+    // Índice da árvore da chave: quantos limites são menores ou iguais a ela
+    size_t shard_of(const K& key) const {
+        auto it = std::upper_bound(this->bounds.begin(), this->bounds.end(), key,
+            [this](const K& a, const K& b) {
+                return this->compare(a, b) < 0;
+            });
+        return it - this->bounds.begin();
+    }
+
+    template<class F>
+    auto with_shard(const K& key, F&& function) {
+        std::shared_lock<std::shared_mutex> lock(this->layout_mutex);
+        Shard& shard = *this->shards[this->shard_of(key)];
+        std::lock_guard<std::mutex> shard_lock(shard.mutex);
+        return function(shard);
+    }
+
+    // Une a cada árvore a sua parte do lote. Espera que layout_mutex esteja bloqueado.
+    void route(const K* keys, const V* values, size_t count, par::WorkStealingPool* pool) {
+        auto less = [this](const K& a, const K& b) {
+            return this->compare(a, b) < 0;
+        };
+        std::vector<size_t> cuts{0};
+        for (const K& bound : this->bounds)
+            cuts.push_back(std::lower_bound(keys + cuts.back(), keys + count, bound, less) - keys);
+        cuts.push_back(count);
+        auto merge = [&](size_t i) {
+            Tree incoming(this->compare);
+            incoming.build_sorted(keys + cuts[i], values + cuts[i], cuts[i + 1] - cuts[i]);
+            Shard& shard = *this->shards[i];
+            std::lock_guard<std::mutex> shard_lock(shard.mutex);
+            shard.balance();
+            shard.tree.set_union(std::move(incoming));
+        };
+        if (!pool || pool->size() == 1) {
+            for (size_t i = 0; i + 1 < cuts.size(); ++i) {
+                if (cuts[i] < cuts[i + 1])
+                    merge(i);
+            }
+            return;
+        }
+        par::TaskGroup group(*pool);
+        for (size_t i = 0; i + 1 < cuts.size(); ++i) {
+            if (cuts[i] < cuts[i + 1])
+                group.run([&merge, i] { merge(i); });
+        }
+        group.wait();
+    }
+};
+
+#endif  // SHARDED_BST_HPP_
@@ -0,0 +1,281 @@
+#ifndef SHM_HPP_
+#define SHM_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "./trace.hpp"
+
+/*
+    Publicação de snapshots de uma árvore em memória compartilhada POSIX,
+    para que outro processo, como o viewer, desenhe a árvore sem que o
+    processo que a mantém dependa de OpenGL. A região tem um cabeçalho de 64
+    bytes seguido do snapshot mais recente, na codificação compacta de
+    trace::encode_tree (chave, valor e um byte de filhos por nó, em
+    pré-ordem).
+
+    O cabeçalho funciona como um seqlock, como as posições de
+    trace::Recorder: quem publica torna a sequência ímpar, escreve e a torna
+    par de novo; quem lê copia o snapshot e descarta a cópia se a sequência
+    mudou no meio. O publicador nunca espera pelos leitores, e um leitor que
+    coincidir com uma publicação só refaz a cópia. A versão é a sequência
+    dividida por 2. Cada região tem um único publicador; se a árvore
+    crescer além da capacidade, a região é aumentada e os leitores a mapeiam
+    de novo ao perceber.
+*/
+
+namespace shm {
+
+struct Header {
+    char magic[8];
+    std::atomic<uint32_t> key_size;
+    std::atomic<uint32_t> value_size;
+    std::atomic<uint64_t> sequence;
+    // Bytes disponíveis depois do cabeçalho e bytes do snapshot atual
+    std::atomic<uint64_t> capacity;
+    std::atomic<uint64_t> length;
+    uint64_t reserved[3];
+};
+
+static_assert(sizeof(Header) == 64, "Header must be 64 bytes.");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+    "Shared memory requires lock-free 64-bit atomics.");
+
+constexpr char magic[8] = {'B', 'S', 'T', 'S', 'H', 'M', '1', '\0'};
+
+// Mapeia length bytes do objeto de memória compartilhada aberto em fd
+inline void* map(int fd, size_t length, bool writable) {
+    void* data = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                      MAP_SHARED, fd, 0);
+    return data == MAP_FAILED ? nullptr : data;
+}
+
+/**
+ * Lado do processo da árvore. O nome segue shm_open, como "/bst". A região
+ * é recriada ao construir e removida ao destruir.
+ */
+class Publisher {
+ public:
+    /// @param capacity Bytes reservados para o snapshot; a região cresce se preciso.
+    explicit Publisher(const std::string& name, size_t capacity = 16 << 20) : name(name) {
+        shm_unlink(name.c_str());
+        this->fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (this->fd < 0)
+            throw std::runtime_error("Could not create shared memory " + name + ".");
+        this->length = sizeof(Header) + capacity;
+        if (ftruncate(this->fd, this->length) < 0 ||
+            !(this->data = map(this->fd, this->length, true))) {
+            close(this->fd);
+            shm_unlink(name.c_str());
+            throw std::runtime_error("Could not map shared memory " + name + ".");
+        }
+        Header* header = new (this->data) Header();
+        header->capacity.store(capacity, std::memory_order_relaxed);
+        std::memcpy(header->magic, magic, sizeof(magic));
+    }
+
+    ~Publisher() {
+        munmap(this->data, this->length);
+        close(this->fd);
+        shm_unlink(this->name.c_str());
+    }
+
+    Publisher(const Publisher&) = delete;
+
+    Publisher& operator=(const Publisher&) = delete;
+
+    /**
+     * Copia a árvore para a região e retorna a nova versão. Custa uma
+     * travessia em pré-ordem e a escrita de encoded_size bytes, durante a
+     * qual a árvore não pode ser alterada; os leitores não são esperados.
+     */
+    template<class Node>
+    uint64_t publish(const Node* root) {
+        using K = decltype(root->m_key);
+        using V = decltype(root->m_value);
+        static_assert(trace::is_traceable<K, V>, "Keys and values must be trivially copyable to be published.");
+        size_t needed = trace::encoded_size<Node>(root ? root->size : 0);
+        Header* header = this->header();
+        uint64_t sequence = header->sequence.load(std::memory_order_relaxed);
+        header->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        if (needed > header->capacity.load(std::memory_order_relaxed)) {
+            try {
+                header = this->grow(needed + needed / 2);
+            } catch (...) {
+                // Nada foi escrito, então a versão anterior continua válida
+                this->header()->sequence.store(sequence, std::memory_order_release);
+                throw;
+            }
+        }
+        trace::encode_tree(root, this->payload());
+        header->key_size.store(sizeof(K), std::memory_order_relaxed);
+        header->value_size.store(sizeof(V), std::memory_order_relaxed);
+        header->length.store(needed, std::memory_order_relaxed);
+        header->sequence.store(sequence + 2, std::memory_order_release);
+        return (sequence + 2) / 2;
+    }
+
+    uint64_t version() const {
+        return this->header()->sequence.load(std::memory_order_relaxed) / 2;
+    }
+
+ private:
+    std::string name;
+    int fd;
+    void* data = nullptr;
+    size_t length;
+
+    Header* header() const {
+        return static_cast<Header*>(this->data);
+    }
+
+    char* payload() const {
+        return static_cast<char*>(this->data) + sizeof(Header);
+    }
+
+    // Aumenta o objeto e o mapeia de novo; a sequência continua ímpar
+    Header* grow(size_t capacity) {
+        size_t length = sizeof(Header) + capacity;
+        if (ftruncate(this->fd, length) < 0)
+            throw std::runtime_error("Could not grow shared memory " + this->name + ".");
+        void* data = map(this->fd, length, true);
+        if (!data)
+            throw std::runtime_error("Could not map shared memory " + this->name + ".");
+        munmap(this->data, this->length);
+        this->data = data;
+        this->length = length;
+        this->header()->capacity.store(capacity, std::memory_order_relaxed);
+        return this->header();
+    }
+};
+
+/// Lado do viewer: lê as versões publicadas por um Publisher com o mesmo nome.
+class Subscriber {
+ public:
+    explicit Subscriber(const std::string& name) : name(name) {
+        this->fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (this->fd < 0)
+            throw std::runtime_error("Could not open shared memory " + name + ".");
+        try {
+            this->remap();
+        } catch (...) {
+            close(this->fd);
+            throw;
+        }
+        if (std::memcmp(this->header()->magic, magic, sizeof(magic)) != 0) {
+            munmap(this->data, this->length);
+            close(this->fd);
+            throw std::runtime_error("Invalid shared memory " + name + ".");
+        }
+    }
+
+    ~Subscriber() {
+        munmap(this->data, this->length);
+        close(this->fd);
+    }
+
+    Subscriber(const Subscriber&) = delete;
+
+    Subscriber& operator=(const Subscriber&) = delete;
+
+    /// Versão mais recente publicada, ou 0 se nada foi publicado ainda.
+    uint64_t version() const {
+        return this->header()->sequence.load(std::memory_order_acquire) / 2;
+    }
+
+    /**
+     * Copia para data o snapshot mais recente se a versão dele for maior que
+     * since e retorna a versão. Retorna 0 se não houver versão nova ou se a
+     * região mudar durante todas as tentativas, caso em que basta chamar de
+     * novo mais tarde.
+     */
+    uint64_t read(std::string& data, uint64_t since = 0, int attempts = 64) {
+        for (int attempt = 0; attempt < attempts; ++attempt) {
+            const Header* header = this->header();
+            uint64_t sequence = header->sequence.load(std::memory_order_acquire);
+            if (sequence / 2 <= since)
+                return 0;
+            if (sequence % 2) {
+                std::this_thread::yield();
+                continue;
+            }
+            uint64_t capacity = header->capacity.load(std::memory_order_relaxed);
+            uint64_t length = header->length.load(std::memory_order_relaxed);
+            uint32_t key_size = header->key_size.load(std::memory_order_relaxed);
+            uint32_t value_size = header->value_size.load(std::memory_order_relaxed);
+            if (sizeof(Header) + capacity > this->length) {
+                this->remap();
+                continue;
+            }
+            if (length > capacity)
+                continue;
+            data.resize(length);
+            std::memcpy(&data[0], static_cast<const char*>(this->data) + sizeof(Header), length);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->sequence.load(std::memory_order_relaxed) == sequence) {
+                this->key_size = key_size;
+                this->value_size = value_size;
+                return sequence / 2;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * Como read, mas monta o snapshot em tree, que deve estar vazia. As
+     * chaves e os valores precisam ter os tamanhos dos publicados.
+     */
+    template<class Tree>
+    uint64_t load(Tree& tree, uint64_t since = 0) {
+        using Node = typename Tree::Node;
+        uint64_t version = this->read(this->buffer, since);
+        if (!version)
+            return 0;
+        if (this->key_size != sizeof(Node::m_key) || this->value_size != sizeof(Node::m_value))
+            throw std::runtime_error("Shared memory " + this->name + " holds other key or value types.");
+        tree.adopt(trace::decode_tree<Node>(this->buffer.data()));
+        return version;
+    }
+
+ private:
+    std::string name;
+    int fd;
+    void* data = nullptr;
+    size_t length = 0;
+    uint32_t key_size = 0;
+    uint32_t value_size = 0;
+    std::string buffer;
+
+    const Header* header() const {
+        return static_cast<const Header*>(this->data);
+    }
+
+    // Mapeia o objeto inteiro de novo, depois de o publicador aumentá-lo
+    void remap() {
+        struct stat info;
+        if (fstat(this->fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(Header))
+            throw std::runtime_error("Invalid shared memory " + this->name + ".");
+        void* data = map(this->fd, info.st_size, false);
+        if (!data)
+            throw std::runtime_error("Could not map shared memory " + this->name + ".");
+        if (this->data)
+            munmap(this->data, this->length);
+        this->data = data;
+        this->length = info.st_size;
+    }
+};
+
+}  // namespace shm
+
+#endif  // SHM_HPP_
@@ -0,0 +1,510 @@
+#ifndef SNAPSHOT_HPP_
+#define SNAPSHOT_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "./BST.hpp"
+
+/*
+    Formato binário para salvar e recarregar árvores. O arquivo tem um
+    cabeçalho de 64 bytes seguido de três seções alinhadas em 64 bytes:
+
+        chaves      count * key_size bytes
+        valores     count * value_size bytes
+        estrutura   2 bits por nó (tem filho esquerdo, tem filho direito),
+                    em palavras de 64 bits, opcional
+
+    Em InOrder, as chaves estão ordenadas e a estrutura, se presente, segue a
+    pré-ordem, permitindo reconstruir a forma exata da árvore. Em LevelOrder,
+    chaves e estrutura seguem a ordem de largura, e a estrutura é obrigatória.
+    Chaves e valores são gravados na representação nativa da máquina, então
+    precisam ser trivialmente copiáveis.
+*/
+
+namespace snapshot {
+
+enum class Order : uint32_t {
+    InOrder = 0,
+    LevelOrder = 1
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    // Detecta arquivos gravados em máquinas com outra ordem de bytes
+    uint32_t endian;
+    uint32_t order;
+    uint32_t flags;
+    uint32_t key_size;
+    uint32_t value_size;
+    uint64_t count;
+    uint64_t keys_offset;
+    uint64_t values_offset;
+    uint64_t structure_offset;
+};
+
+static_assert(sizeof(Header) == 64, "Header must be 64 bytes.");
+
+constexpr char magic[8] = {'B', 'S', 'T', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t version = 1;
+constexpr uint32_t endian_marker = 0x01020304;
+constexpr uint32_t has_structure = 1;
+
+inline uint64_t align(uint64_t offset) {
+    return (offset + 63) & ~uint64_t(63);
+}
+
+// Calcula as posições das seções a partir da quantidade de nós
+inline Header make_header(uint64_t count, uint32_t key_size, uint32_t value_size,
+                          Order order, bool structure) {
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.endian = endian_marker;
+    header.order = static_cast<uint32_t>(order);
+    header.flags = structure ? has_structure : 0;
+    header.key_size = key_size;
+    header.value_size = value_size;
+    header.count = count;
+    header.keys_offset = sizeof(Header);
+    header.values_offset = align(header.keys_offset + count * key_size);
+    header.structure_offset = structure ? align(header.values_offset + count * value_size) : 0;
+    return header;
+}
+
+// Acumula pequenas escritas em blocos de tamanho fixo antes de enviá-las ao
+// arquivo, já que chamar write para cada chave custa mais que a própria cópia
+class ChunkWriter {
+ public:
+    explicit ChunkWriter(std::ostream& os) : os(os), chunk(1 << 16), used(0) {}
+
+    ~ChunkWriter() {
+        this->flush();
+    }
+
+    template<class T>
+    void put(const T& value) {
+        if (this->used + sizeof(T) > this->chunk.size())
+            this->flush();
+        std::memcpy(this->chunk.data() + this->used, &value, sizeof(T));
+        this->used += sizeof(T);
+    }
+
+    void flush() {
+        this->os.write(this->chunk.data(), this->used);
+        this->used = 0;
+    }
+
+ private:
+    std::ostream& os;
+    std::vector<char> chunk;
+    size_t used;
+};
+
+// Grava bits de estrutura em palavras de 64 bits, à medida que são gerados
+class BitWriter {
+ public:
+    explicit BitWriter(std::ostream& os) : writer(os) {}
+
+    void push(bool bit) {
+        this->word |= uint64_t(bit) << this->used;
+        if (++this->used == 64) {
+            this->writer.put(this->word);
+            this->word = 0;
+            this->used = 0;
+        }
+    }
+
+    // Grava a última palavra, completada com zeros
+    void flush() {
+        if (this->used > 0)
+            this->writer.put(this->word);
+        this->writer.flush();
+        this->word = 0;
+        this->used = 0;
+    }
+
+ private:
+    ChunkWriter writer;
+    uint64_t word = 0;
+    uint32_t used = 0;
+};
+
+inline void pad_to(std::ostream& os, uint64_t offset) {
+    static const char zeros[64] = {};
+    uint64_t position = os.tellp();
+    if (offset > position)
+        os.write(zeros, offset - position);
+}
+
+/**
+ * Grava a árvore sem copiá-la para um buffer: cada seção é escrita por uma
+ * travessia própria, usando memória proporcional à altura (InOrder) ou à
+ * largura (LevelOrder) da árvore.
+ *
+ * @param order Ordem das chaves no arquivo.
+ * @param structure Em InOrder, define se a forma da árvore é preservada.
+ */
+template<class K, class V, class Compare, class Access, class Digest, class Augment>
+void write(const BST<K, V, Compare, Access, Digest, Augment>& tree, const std::string& path, Order order = Order::InOrder,
+           bool structure = false) {
+    static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+        "Keys and values must be trivially copyable.");
+    using Node = typename BST<K, V, Compare, Access, Digest, Augment>::Node;
+    // Depois de to_list, m_left aponta para o nó anterior e as travessias não terminam
+    tree.require_tree();
+    if (order == Order::LevelOrder)
+        structure = true;
+    Node* root = tree.get_root();
+    Header header = make_header(root ? root->size : 0, sizeof(K), sizeof(V), order, structure);
+
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    if (!os)
+        throw std::runtime_error("Could not open " + path + ".");
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if (order == Order::InOrder) {
+        pad_to(os, header.keys_offset);
+        {
+            ChunkWriter writer(os);
+            par::for_each_serial(root, [&writer](const Node* node) {
+                writer.put(node->m_key);
+            });
+        }
+        pad_to(os, header.values_offset);
+        {
+            ChunkWriter writer(os);
+            par::for_each_serial(root, [&writer](const Node* node) {
+                writer.put(node->m_value);
+            });
+        }
+        if (structure) {
+            pad_to(os, header.structure_offset);
+            BitWriter bits(os);
+            std::vector<const Node*> stack;
+            if (root)
+                stack.push_back(root);
+            while (!stack.empty()) {
+                const Node* node = stack.back();
+                stack.pop_back();
+                bits.push(node->m_left);
+                bits.push(node->m_right);
+                if (node->m_right)
+                    stack.push_back(node->m_right);
+                if (node->m_left)
+                    stack.push_back(node->m_left);
+            }
+            bits.flush();
+        }
+    } else {
+        // Percorre a árvore em largura uma vez por seção
+        auto breadth = [root](auto&& visit) {
+            std::vector<const Node*> current, next;
+            if (root)
+                current.push_back(root);
+            while (!current.empty()) {
+                for (const Node* node : current) {
+                    visit(node);
+                    if (node->m_left)
+                        next.push_back(node->m_left);
+                    if (node->m_right)
+                        next.push_back(node->m_right);
+                }
+                current.swap(next);
+                next.clear();
+            }
+        };
+        pad_to(os, header.keys_offset);
+        {
+            ChunkWriter writer(os);
+            breadth([&writer](const Node* node) {
+                writer.put(node->m_key);
+            });
+        }
+        pad_to(os, header.values_offset);
+        {
+            ChunkWriter writer(os);
+            breadth([&writer](const Node* node) {
+                writer.put(node->m_value);
+            });
+        }
+        pad_to(os, header.structure_offset);
+        BitWriter bits(os);
+        breadth([&bits](const Node* node) {
+            bits.push(node->m_left);
+            bits.push(node->m_right);
+        });
+        bits.flush();
+    }
+    os.flush();
+    if (!os)
+        throw std::runtime_error("Could not write " + path + ".");
+}
+
+/**
+ * Snapshot mapeado em memória com mmap. As buscas são feitas diretamente no
+ * arquivo, sem copiar nada: busca binária em InOrder e descida pela árvore
+ * implícita em LevelOrder, cujos filhos são encontrados contando bits.
+ * Também pode reconstruir uma BST em tempo linear.
+ */
+template<class K, class V, class Compare = cmp::ThreeWay>
+class MappedSnapshot {
+ public:
+    explicit MappedSnapshot(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Could not open " + path + ".");
+        struct stat info;
+        if (fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+            close(fd);
+            throw std::runtime_error("Invalid snapshot " + path + ".");
+        }
+        this->length = info.st_size;
+        this->data = mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (this->data == MAP_FAILED) {
+            this->data = nullptr;
+            throw std::runtime_error("Could not map " + path + ".");
+        }
+        try {
+            this->validate();
+        } catch (...) {
+            munmap(this->data, this->length);
+            throw;
+        }
+        if (this->header().flags & has_structure)
+            this->build_rank_directory();
+    }
+
+    ~MappedSnapshot() {
+        if (this->data)
+            munmap(this->data, this->length);
+    }
+
+    MappedSnapshot(const MappedSnapshot&) = delete;
+
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+    const Header& header() const {
+        return *static_cast<const Header*>(this->data);
+    }
+
+    size_t size() const {
+        return this->header().count;
+    }
+
+    Order order() const {
+        return static_cast<Order>(this->header().order);
+    }
+
+    const K* keys() const {
+        return reinterpret_cast<const K*>(this->bytes() + this->header().keys_offset);
+    }
+
+    const V* values() const {
+        return reinterpret_cast<const V*>(this->bytes() + this->header().values_offset);
+    }
+
+    /// Retorna um ponteiro para o valor da chave no arquivo, ou nulo se ela não existir.
+    const V* find(const K& key) const {
+        const K* keys = this->keys();
+        size_t count = this->size();
+        Compare compare;
+        if (this->order() == Order::InOrder) {
+            const K* found = std::lower_bound(keys, keys + count, key,
+                [&compare](const K& a, const K& b) { return compare(a, b) < 0; });
+            if (found == keys + count || compare(key, *found) != 0)
+                return nullptr;
+            return this->values() + (found - keys);
+        }
+        if (count == 0)
+            return nullptr;
+        size_t index = 0;
+        while (true) {
+            int order = compare(key, keys[index]);
+            if (order == 0)
+                return this->values() + index;
+            bool right = order > 0;
+            if (!this->bit(2 * index + right))
+                return nullptr;
+            index = this->child(index, right);
+        }
+    }
+
+    /**
+     * Monta uma BST em tempo linear. Sem estrutura, a árvore é perfeitamente
+     * balanceada; com estrutura, a forma original é reproduzida.
+     */
+    template<class Access, class Digest, class Augment>
+    void load_into(BST<K, V, Compare, Access, Digest, Augment>& tree) const {
+        using Node = typename BST<K, V, Compare, Access, Digest, Augment>::Node;
+        // Conferido antes de criar os nós, que adopt não liberaria
+        if (tree.get_root())
+            throw std::runtime_error("Tree is not empty.");
+        size_t count = this->size();
+        if (count == 0)
+            return;
+        if (!(this->header().flags & has_structure)) {
+            tree.build_sorted(this->keys(), this->values(), count);
+            return;
+        }
+        // Todo nó menos a raiz é filho de exatamente um nó
+        if (this->ones() != count - 1)
+            throw std::runtime_error("Invalid snapshot structure.");
+        std::vector<Node*> nodes(count);
+        // Libera os nós já criados antes de rejeitar uma estrutura inválida
+        auto invalid = [&nodes] {
+            for (Node* node : nodes)
+                delete node;
+            throw std::runtime_error("Invalid snapshot structure.");
+        };
+        if (this->order() == Order::LevelOrder) {
+            for (size_t i = 0; i < count; ++i)
+                nodes[i] = new Node(this->keys()[i], this->values()[i]);
+            for (size_t i = 0; i < count; ++i) {
+                for (bool right : {false, true}) {
+                    if (!this->bit(2 * i + right))
+                        continue;
+                    // Um filho antes do pai formaria um ciclo
+                    size_t child = this->child(i, right);
+                    if (child <= i)
+                        invalid();
+                    this->link(nodes[i], nodes[child], !right);
+                }
+            }
+        } else {
+            // Monta a forma em pré-ordem, guardando as posições de filhos ainda
+            // não preenchidas, e depois preenche as chaves em ordem simétrica
+            std::vector<std::pair<Node*, bool>> slots;
+            for (size_t i = 0; i < count; ++i) {
+                nodes[i] = new Node(K(), V());
+                if (i > 0) {
+                    if (slots.empty())
+                        invalid();
+                    this->link(slots.back().first, nodes[i], slots.back().second);
+                    slots.pop_back();
+                }
+                if (this->bit(2 * i + 1))
+                    slots.emplace_back(nodes[i], false);
+                if (this->bit(2 * i))
+                    slots.emplace_back(nodes[i], true);
+            }
+            if (!slots.empty())
+                invalid();
+            size_t k = 0;
+            par::for_each_serial(nodes[0], [this, &k](Node* node) {
+                node->m_key = this->keys()[k];
+                node->m_value = this->values()[k];
+                ++k;
+            });
+        }
+        // Os tamanhos são calculados por adopt
+        tree.adopt(nodes[0]);
+    }
+
+ private:
+    void* data = nullptr;
+    size_t length = 0;
+    // Quantidade de bits 1 antes de cada palavra da estrutura
+    std::vector<uint64_t> ranks;
+
+    const char* bytes() const {
+        return static_cast<const char*>(this->data);
+    }
+
+    const uint64_t* words() const {
+        return reinterpret_cast<const uint64_t*>(this->bytes() + this->header().structure_offset);
+    }
+
+    bool bit(size_t index) const {
+        return (this->words()[index / 64] >> (index % 64)) & 1;
+    }
+
+    // Quantidade de bits 1 nas posições [0, index)
+    size_t rank(size_t index) const {
+        uint64_t word = this->words()[index / 64];
+        uint64_t mask = (uint64_t(1) << (index % 64)) - 1;
+        return this->ranks[index / 64] + __builtin_popcountll(word & mask);
+    }
+
+    // Quantidade de bits 1 em toda a estrutura, sem os bits de preenchimento
+    size_t ones() const {
+        size_t bits = 2 * this->size();
+        if (bits % 64 == 0)
+            return this->ranks[bits / 64];
+        return this->rank(bits);
+    }
+
+    // Em ordem de largura, os filhos do nó i vêm logo após os filhos dos nós
+    // anteriores, então o primeiro filho fica após todos os bits 1 anteriores
+    size_t child(size_t index, bool right) const {
+        size_t first = 1 + this->rank(2 * index);
+        return right ? first + this->bit(2 * index) : first;
+    }
+
+    template<class Node>
+    static void link(Node* parent, Node* child, bool left) {
+        (left ? parent->m_left : parent->m_right) = child;
+        child->m_parent = parent;
+    }
+
+    void validate() const {
+        const Header& header = this->header();
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+            throw std::runtime_error("Not a tree snapshot.");
+        if (header.version != version || header.endian != endian_marker)
+            throw std::runtime_error("Unsupported snapshot version or byte order.");
+        if (header.key_size != sizeof(K) || header.value_size != sizeof(V))
+            throw std::runtime_error("Snapshot key or value type does not match.");
+        if (header.order > static_cast<uint32_t>(Order::LevelOrder))
+            throw std::runtime_error("Invalid snapshot.");
+        if (header.order == static_cast<uint32_t>(Order::LevelOrder) &&
+            !(header.flags & has_structure))
+            throw std::runtime_error("Level order snapshot without structure.");
+        // As seções vêm depois do cabeçalho, alinhadas, em ordem e sem se sobrepor
+        uint64_t end = section(sizeof(Header), header.keys_offset, header.count, sizeof(K));
+        end = section(end, header.values_offset, header.count, sizeof(V));
+        if (header.flags & has_structure) {
+            // 2 bits por nó, em palavras de 8 bytes
+            uint64_t words = header.count / 32 + (header.count % 32 != 0);
+            end = section(end, header.structure_offset, words, 8);
+        }
+        if (end > this->length)
+            throw std::runtime_error("Truncated snapshot.");
+    }
+
+    // Fim de uma seção de count elementos de size bytes que começa em offset,
+    // que deve estar alinhado e não antes de start
+    static uint64_t section(uint64_t start, uint64_t offset, uint64_t count, uint64_t size) {
+        uint64_t bytes, end;
+        if (offset < start || offset % 64 != 0 || __builtin_mul_overflow(count, size, &bytes) ||
+            __builtin_add_overflow(offset, bytes, &end))
+            throw std::runtime_error("Invalid snapshot.");
+        return end;
+    }
+
+    void build_rank_directory() {
+        size_t words = (2 * this->size() + 63) / 64;
+        this->ranks.resize(words + 1);
+        const uint64_t* bits = this->words();
+        for (size_t i = 0; i < words; ++i)
+            this->ranks[i + 1] = this->ranks[i] + __builtin_popcountll(bits[i]);
+    }
+};
+
+}  // namespace snapshot
+
+#endif  // SNAPSHOT_HPP_
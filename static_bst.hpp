@@ -0,0 +1,209 @@
+#ifndef STATIC_BST_HPP_
+#define STATIC_BST_HPP_
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+#include "./compare.hpp"
+
+/*
+    Árvore imutável para conjuntos de chaves conhecidos na compilação. Os
+    nós ficam em vetores de tamanho fixo, sem ponteiros, na ordem de
+    Eytzinger: a raiz é o índice 1 e os filhos de i são 2i e 2i + 1, a mesma
+    numeração de BST::grow_doubles. A árvore é completa, então a altura é
+    log2(N) e a busca é um laço curto sem desvios imprevisíveis, que o
+    compilador pode expandir por inteiro. Tudo é constexpr: declarada como
+    static constexpr, a árvore é montada pelo compilador e fica em memória
+    somente leitura, e buscas por chaves constantes viram constantes.
+*/
+
+template<class K, class V, size_t N>
+class StaticBST {
+ public:
+    using key_type = K;
+    using mapped_type = V;
+
+    static_assert(N > 0, "StaticBST needs at least one key.");
+
+    /**
+     * Referência a um nó que se comporta como ponteiro, com os métodos que a
+     * Visualization usa. O índice 0 representa a ausência de nó.
+     */
+    class NodeView {
+     public:
+        constexpr NodeView(const StaticBST* tree = nullptr, size_t index = 0)
+            : tree(tree), index(index) {}
+
+        constexpr const NodeView* operator->() const {
+            return this;
+        }
+
+        constexpr explicit operator bool() const {
+            return this->index != 0;
+        }
+
+        constexpr bool operator==(const NodeView& other) const {
+            return this->index == other.index && this->tree == other.tree;
+        }
+
+        constexpr bool operator!=(const NodeView& other) const {
+            return !(*this == other);
+        }
+
+        // Visualização:
+        constexpr NodeView left() const {
+            return this->child(2 * this->index);
+        }
+
+        constexpr NodeView right() const {
+            return this->child(2 * this->index + 1);
+        }
+
+        constexpr NodeView parent() const {
+            return NodeView(this->tree, this->index / 2);
+        }
+
+        constexpr K key() const {
+            return this->tree->keys[this->index];
+        }
+
+        constexpr V value() const {
+            return this->tree->values[this->index];
+        }
+
+        constexpr size_t get_index() const {
+            return this->index;
+        }
+
+     private:
+        const StaticBST* tree;
+        size_t index;
+
+        constexpr NodeView child(size_t index) const {
+            return NodeView(this->tree, index <= N ? index : 0);
+        }
+    };
+
+    /**
+     * Monta a árvore a partir de chaves sem repetição, em qualquer ordem.
+     * Chaves já ordenadas não passam pela ordenação, o que conta para o
+     * limite de operações do compilador em tabelas grandes.
+     */
+    constexpr StaticBST(const std::array<K, N>& keys, const std::array<V, N>& values) {
+        std::array<K, N> sorted_keys = keys;
+        std::array<V, N> sorted_values = values;
+        size_t sorted = 1;
+        while (sorted < N && sorted_keys[sorted - 1] < sorted_keys[sorted])
+            ++sorted;
+        if (sorted < N)
+            heap_sort(sorted_keys, sorted_values);
+        for (size_t i = 1; i < N; ++i) {
+            if (!(sorted_keys[i - 1] < sorted_keys[i]))
+                throw std::invalid_argument("Can't build a StaticBST with duplicated keys.");
+        }
+        size_t next = 0;
+        this->fill(1, sorted_keys, sorted_values, next);
+    }
+
+    constexpr size_t size() const {
+        return N;
+    }
+
+    constexpr NodeView get_root() const {
+        return NodeView(this, 1);
+    }
+
+    /// Retorna o valor associado à chave ou nullptr se ela não existir.
+    constexpr const V* find(const K& key) const {
+        size_t index = this->lower_bound(key);
+        if (index && !(key < this->keys[index]))
+            return &this->values[index];
+        return nullptr;
+    }
+
+    constexpr bool contains(const K& key) const {
+        return this->find(key) != nullptr;
+    }
+
+    constexpr const V& search(const K& key) const {
+        const V* value = this->find(key);
+        if (!value)
+            throw std::invalid_argument("Key" + cmp::describe(key) + " not found.");
+        return *value;
+    }
+
+    /// Índice do nó com a menor chave maior ou igual a key, ou 0 se não houver.
+    constexpr size_t lower_bound(const K& key) const {
+        size_t index = 1;
+        while (index <= N)
+            index = 2 * index + (this->keys[index] < key);
+        // Os bits baixos são as descidas; as descidas à direita finais levaram
+        // a chaves menores, então o resultado é o nó antes delas
+        return index >> (__builtin_ctzll(~static_cast<unsigned long long>(index)) + 1);
+    }
+
+ private:
+    // Índice 0 não é usado, para que os filhos de i sejam 2i e 2i + 1
+    std::array<K, N + 1> keys{};
+    std::array<V, N + 1> values{};
+
+    // Distribui as chaves ordenadas pelos índices, percorrendo-os em ordem
+    constexpr void fill(size_t index, const std::array<K, N>& sorted_keys,
+                        const std::array<V, N>& sorted_values, size_t& next) {
+        if (index > N)
+            return;
+        this->fill(2 * index, sorted_keys, sorted_values, next);
+        this->keys[index] = sorted_keys[next];
+        this->values[index] = sorted_values[next];
+        ++next;
+        this->fill(2 * index + 1, sorted_keys, sorted_values, next);
+    }
+
+    // std::sort só é constexpr a partir do C++20
+    static constexpr void heap_sort(std::array<K, N>& keys, std::array<V, N>& values) {
+        auto swap = [&](size_t a, size_t b) {
+            K key = keys[a];
+            keys[a] = keys[b];
+            keys[b] = key;
+            V value = values[a];
+            values[a] = values[b];
+            values[b] = value;
+        };
+        auto sift_down = [&](size_t root, size_t end) {
+            while (2 * root + 1 < end) {
+                size_t child = 2 * root + 1;
+                if (child + 1 < end && keys[child] < keys[child + 1])
+                    ++child;
+                if (!(keys[root] < keys[child]))
+                    return;
+                swap(root, child);
+                root = child;
+            }
+        };
+        for (size_t i = N / 2; i-- > 0;)
+            sift_down(i, N);
+        for (size_t end = N - 1; end > 0; --end) {
+            swap(0, end);
+            sift_down(0, end);
+        }
+    }
+};
+
+/**
+ * Monta uma StaticBST a partir de uma lista de pares, como em
+ * `static constexpr auto table = make_static_bst<int, int>({{1, 10}, {2, 20}});`
+ */
+template<class K, class V, size_t N>
+constexpr StaticBST<K, V, N> make_static_bst(const std::pair<K, V> (&items)[N]) {
+    std::array<K, N> keys{};
+    std::array<V, N> values{};
+    for (size_t i = 0; i < N; ++i) {
+        keys[i] = items[i].first;
+        values[i] = items[i].second;
+    }
+    return StaticBST<K, V, N>(keys, values);
+}
+
+#endif  // STATIC_BST_HPP_
@@ -0,0 +1,184 @@
+#ifndef STATS_HPP_
+#define STATS_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+    Estatísticas da forma de uma árvore, para descobrir de fora se ela
+    degenerou. Funcionam com qualquer nó que tenha os métodos left() e right()
+    usados pela Visualization; os índices de balanceamento e a estimativa por
+    amostragem também usam o campo size, quando existe.
+*/
+
+namespace stats {
+
+template<class NodePtr, class = void>
+struct has_size : std::false_type {};
+
+template<class NodePtr>
+struct has_size<NodePtr, std::void_t<decltype(std::declval<NodePtr>()->size)>> : std::true_type {};
+
+struct Summary {
+    size_t count = 0;
+    // Profundidade da raiz é 0; max_depth + 1 é a altura
+    size_t max_depth = 0;
+    double average_depth = 0.0;
+    // Nós em cada nível, estimados quando sampled é verdadeiro
+    std::vector<double> levels;
+    // Peso (tamanho + 1) do menor lado da raiz dividido pelo peso da árvore:
+    // 0.5 é perfeito e perto de 0 é degenerado. Negativo sem o campo size.
+    double root_balance = -1.0;
+    // Fração dos nós em que o menor lado pesa menos que alpha do total
+    double unbalanced = -1.0;
+    size_t bytes = 0;
+    bool sampled = false;
+
+    size_t height() const {
+        return this->count ? this->max_depth + 1 : 0;
+    }
+
+    /// Altura dividida pela de uma árvore perfeitamente balanceada.
+    double height_ratio() const {
+        return this->count ? this->height() / std::ceil(std::log2(this->count + 1.0)) : 1.0;
+    }
+
+    std::string to_string() const {
+        std::ostringstream os;
+        os.precision(3);
+        os << "n=" << this->count << " h=" << this->height() << " avg=" << this->average_depth;
+        if (this->root_balance >= 0)
+            os << " bal=" << this->root_balance << " unb=" << this->unbalanced;
+        if (this->sampled)
+            os << " ~";
+        return os.str();
+    }
+};
+
+template<class NodePtr>
+size_t size_of(NodePtr node) {
+    return node ? static_cast<size_t>(node->size) : 0;
+}
+
+template<class NodePtr>
+bool is_unbalanced(NodePtr node, double alpha) {
+    size_t left = size_of(node->left()) + 1;
+    size_t right = size_of(node->right()) + 1;
+    return std::min(left, right) < alpha * (left + right);
+}
+
+template<class NodePtr>
+size_t node_bytes() {
+    if constexpr (std::is_pointer<NodePtr>::value)
+        return sizeof(std::remove_pointer_t<NodePtr>);
+    else
+        return 0;
+}
+
+/**
+ * Percorre a árvore uma vez, sem recursão, com uma pilha proporcional à
+ * altura. bytes considera só sizeof do nó, sem o cabeçalho do malloc, e fica
+ * 0 se NodePtr não for um ponteiro.
+ *
+ * @param alpha Limite de balanceamento por peso usado em unbalanced.
+ */
+template<class NodePtr>
+Summary collect(NodePtr root, double alpha = 0.29) {
+    Summary summary;
+    size_t unbalanced = 0;
+    double depth_sum = 0.0;
+    std::vector<std::pair<NodePtr, size_t>> stack;
+    if (root)
+        stack.emplace_back(root, 0);
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+        ++summary.count;
+        depth_sum += depth;
+        if (depth >= summary.levels.size())
+            summary.levels.resize(depth + 1, 0.0);
+        summary.levels[depth] += 1;
+        if constexpr (has_size<NodePtr>::value)
+            unbalanced += is_unbalanced(node, alpha);
+        if (node->right())
+            stack.emplace_back(node->right(), depth + 1);
+        if (node->left())
+            stack.emplace_back(node->left(), depth + 1);
+    }
+    if (summary.count) {
+        summary.max_depth = summary.levels.size() - 1;
+        summary.average_depth = depth_sum / summary.count;
+        summary.bytes = summary.count * node_bytes<NodePtr>();
+        if constexpr (has_size<NodePtr>::value) {
+            summary.root_balance = std::min(size_of(root->left()), size_of(root->right())) + 1.0;
+            summary.root_balance /= summary.count + 1.0;
+            summary.unbalanced = static_cast<double>(unbalanced) / summary.count;
+        }
+    }
+    return summary;
+}
+
+/**
+ * Estima as estatísticas em O(samples * altura) a partir de nós escolhidos
+ * uniformemente, descendo pela posição de cada um com o campo size. count,
+ * bytes e root_balance são exatos; max_depth é o maior valor amostrado, então
+ * subestima a altura.
+ */
+template<class NodePtr>
+Summary sample(NodePtr root, size_t samples, double alpha = 0.29, unsigned seed = 42) {
+    static_assert(has_size<NodePtr>::value, "Sampling requires the size field.");
+    Summary summary;
+    summary.sampled = true;
+    if (!root || samples == 0)
+        return summary;
+    summary.count = size_of(root);
+    summary.bytes = summary.count * node_bytes<NodePtr>();
+    summary.root_balance = std::min(size_of(root->left()), size_of(root->right())) + 1.0;
+    summary.root_balance /= summary.count + 1.0;
+
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<size_t> uniform(0, summary.count - 1);
+    size_t unbalanced = 0;
+    double depth_sum = 0.0;
+    for (size_t i = 0; i < samples; ++i) {
+        size_t rank = uniform(gen);
+        NodePtr node = root;
+        size_t depth = 0;
+        while (true) {
+            size_t left = size_of(node->left());
+            if (rank == left)
+                break;
+            if (rank < left) {
+                node = node->left();
+            } else {
+                rank -= left + 1;
+                node = node->right();
+            }
+            ++depth;
+        }
+        depth_sum += depth;
+        if (depth >= summary.levels.size())
+            summary.levels.resize(depth + 1, 0.0);
+        summary.levels[depth] += 1;
+        unbalanced += is_unbalanced(node, alpha);
+    }
+    double scale = static_cast<double>(summary.count) / samples;
+    for (double& level : summary.levels)
+        level *= scale;
+    summary.max_depth = summary.levels.size() - 1;
+    summary.average_depth = depth_sum / samples;
+    summary.unbalanced = static_cast<double>(unbalanced) / samples;
+    return summary;
+}
+
+}  // namespace stats
+
+#endif  // STATS_HPP_
@@ -0,0 +1,415 @@
+#ifndef TRACE_HPP_
+#define TRACE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+    Registro das operações que alteram uma árvore, para reconstruir qualquer
+    estado recente dela ao investigar um problema. As operações vão para um
+    buffer circular de tamanho fixo, sem locks, e de tempos em tempos a árvore
+    inteira é salva como um checkpoint, a partir do qual os eventos seguintes
+    podem ser reaplicados.
+*/
+
+namespace trace {
+
+enum class Op : uint32_t {
+    Insert,
+    Erase,
+    RotateLeft,
+    RotateRight,
+    Rebalance,
+    Bulk
+};
+
+inline const char* name(Op op) {
+    switch (op) {
+        case Op::Insert: return "insert";
+        case Op::Erase: return "erase";
+        case Op::RotateLeft: return "rotate_left";
+        case Op::RotateRight: return "rotate_right";
+        case Op::Rebalance: return "rebalance";
+        case Op::Bulk: return "bulk";
+    }
+    return "unknown";
+}
+
+/// Só chaves e valores que podem ser copiados byte a byte são gravados.
+template<class K, class V>
+constexpr bool is_traceable = std::is_trivially_copyable<K>::value &&
+                              std::is_trivially_copyable<V>::value;
+
+/// Evento gravado no buffer. Em rotações, a chave é a do nó que desce.
+template<class K, class V>
+struct Event {
+    uint64_t sequence;
+    Op op;
+    K key;
+    V value;
+};
+
+/// Estado completo da árvore antes do evento de número sequence.
+struct Checkpoint {
+    uint64_t sequence;
+    std::string data;
+};
+
+/*
+    Serialização compacta de uma árvore para checkpoints: quantidade de nós e,
+    para cada nó em pré-ordem, chave, valor e um byte indicando quais filhos
+    existem. Funciona com qualquer nó que tenha os campos de BST::Node.
+*/
+template<class Node>
+size_t encoded_size(uint64_t count) {
+    return sizeof(count) + count * (sizeof(Node::m_key) + sizeof(Node::m_value) + 1);
+}
+
+/// Grava a árvore em out, que precisa de encoded_size(root->size) bytes.
+template<class Node>
+void encode_tree(const Node* root, char* out) {
+    uint64_t count = root ? root->size : 0;
+    std::memcpy(out, &count, sizeof(count));
+    out += sizeof(count);
+    std::vector<const Node*> stack;
+    if (root)
+        stack.push_back(root);
+    while (!stack.empty()) {
+        const Node* node = stack.back();
+        stack.pop_back();
+        std::memcpy(out, &node->m_key, sizeof(node->m_key));
+        out += sizeof(node->m_key);
+        std::memcpy(out, &node->m_value, sizeof(node->m_value));
+        out += sizeof(node->m_value);
+        *out++ = static_cast<char>((node->m_left ? 1 : 0) | (node->m_right ? 2 : 0));
+        if (node->m_right)
+            stack.push_back(node->m_right);
+        if (node->m_left)
+            stack.push_back(node->m_left);
+    }
+}
+
+template<class Node>
+std::string encode_tree(const Node* root) {
+    std::string data(encoded_size<Node>(root ? root->size : 0), '\0');
+    encode_tree(root, &data[0]);
+    return data;
+}
+
+template<class Node>
+Node* decode_tree(const char* data) {
+    uint64_t count;
+    std::memcpy(&count, data, sizeof(count));
+    const char* cursor = data + sizeof(count);
+    std::vector<Node*> nodes(count);
+    // Posições de filhos ainda não preenchidas: nó pai e se é o filho esquerdo
+    std::vector<std::pair<Node*, bool>> slots;
+    for (uint64_t i = 0; i < count; ++i) {
+        Node* node = new Node(decltype(node->m_key)(), decltype(node->m_value)());
+        std::memcpy(&node->m_key, cursor, sizeof(node->m_key));
+        cursor += sizeof(node->m_key);
+        std::memcpy(&node->m_value, cursor, sizeof(node->m_value));
+        cursor += sizeof(node->m_value);
+        char children = *cursor++;
+        if (i > 0) {
+            Node* parent = slots.back().first;
+            (slots.back().second ? parent->m_left : parent->m_right) = node;
+            node->m_parent = parent;
+            slots.pop_back();
+        }
+        if (children & 2)
+            slots.emplace_back(node, false);
+        if (children & 1)
+            slots.emplace_back(node, true);
+        nodes[i] = node;
+    }
+    // Em pré-ordem, o pai vem antes dos filhos
+    for (uint64_t i = count; i-- > 1;)
+        nodes[i]->m_parent->size += nodes[i]->size;
+    return count ? nodes[0] : nullptr;
+}
+
+template<class Node>
+Node* decode_tree(const std::string& data) {
+    return decode_tree<Node>(data.data());
+}
+
+/**
+ * Gravador de eventos em um buffer circular de capacidade fixa (potência de
+ * 2), em que os eventos mais antigos são sobrescritos. Cada posição funciona
+ * como um seqlock: quem grava reserva um número de sequência com uma única
+ * operação atômica e publica o evento ao final, enquanto leitores copiam o
+ * conteúdo e descartam posições que mudaram durante a cópia. Assim, vários
+ * produtores e leitores podem usar o buffer sem locks.
+ *
+ * Com o gravador parado, o custo por operação é uma leitura atômica relaxada.
+ */
+template<class K, class V>
+class Recorder {
+ public:
+    static_assert(is_traceable<K, V>, "Keys and values must be trivially copyable to be traced.");
+
+    using EventType = Event<K, V>;
+
+    /**
+     * @param capacity Quantidade de eventos mantidos, arredondada para potência de 2.
+     * @param checkpoint_interval Eventos entre checkpoints; 0 desativa os periódicos.
+     * @param max_checkpoints Quantidade máxima de checkpoints guardados.
+     */
+    explicit Recorder(size_t capacity = 1 << 16, uint64_t checkpoint_interval = 0,
+                      size_t max_checkpoints = 4)
+        : interval(checkpoint_interval), max_checkpoints(std::max<size_t>(max_checkpoints, 1)) {
+        size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        this->mask = size - 1;
+        this->slots.reset(new Slot[size]);
+    }
+
+    Recorder(const Recorder&) = delete;
+
+    Recorder& operator=(const Recorder&) = delete;
+
+    void start() {
+        this->active.store(true, std::memory_order_relaxed);
+    }
+
+    void stop() {
+        this->active.store(false, std::memory_order_relaxed);
+    }
+
+    bool is_active() const {
+        return this->active.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const {
+        return this->mask + 1;
+    }
+
+    /// Número de sequência do próximo evento.
+    uint64_t sequence() const {
+        return this->head.load(std::memory_order_acquire);
+    }
+
+    /// Grava um evento e retorna verdadeiro se um checkpoint deve ser feito agora.
+    bool record(Op op, const K& key, const V& value) {
+        if (!this->active.load(std::memory_order_relaxed))
+            return false;
+        uint64_t sequence = this->head.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = this->slots[sequence & this->mask];
+        // Número ímpar indica que a posição está sendo escrita
+        slot.state.store(2 * sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.event.sequence = sequence;
+        slot.event.op = op;
+        slot.event.key = key;
+        slot.event.value = value;
+        slot.state.store(2 * sequence + 2, std::memory_order_release);
+        return this->interval && (sequence + 1) % this->interval == 0;
+    }
+
+    /// Guarda o estado da árvore antes do evento de número sequence.
+    void add_checkpoint(uint64_t sequence, std::string data) {
+        std::lock_guard<std::mutex> lock(this->checkpoint_mutex);
+        this->stored.push_back(Checkpoint{sequence, std::move(data)});
+        if (this->stored.size() > this->max_checkpoints)
+            this->stored.erase(this->stored.begin());
+    }
+
+    std::vector<Checkpoint> checkpoints() const {
+        std::lock_guard<std::mutex> lock(this->checkpoint_mutex);
+        return this->stored;
+    }
+
+    /// Copia os eventos ainda presentes no buffer, em ordem, sem bloquear quem grava.
+    std::vector<EventType> events() const {
+        std::vector<EventType> result;
+        uint64_t end = this->sequence();
+        uint64_t begin = end > this->capacity() ? end - this->capacity() : 0;
+        result.reserve(end - begin);
+        for (uint64_t sequence = begin; sequence < end; ++sequence) {
+            const Slot& slot = this->slots[sequence & this->mask];
+            uint64_t before = slot.state.load(std::memory_order_acquire);
+            EventType event = slot.event;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t after = slot.state.load(std::memory_order_relaxed);
+            // Descarta eventos incompletos ou já sobrescritos
+            if (before == after && before == 2 * sequence + 2)
+                result.push_back(event);
+        }
+        return result;
+    }
+
+    /**
+     * Salva os checkpoints e os eventos em um arquivo, que pode ser aberto
+     * por Replayer::load para reconstruir os estados em outro processo.
+     */
+    void dump(const std::string& path) const {
+        std::vector<Checkpoint> checkpoints = this->checkpoints();
+        std::vector<EventType> events = this->events();
+        std::ofstream os(path, std::ios::binary | std::ios::trunc);
+        if (!os)
+            throw std::runtime_error("Could not open " + path + ".");
+        uint64_t header[5] = {file_magic, sizeof(K), sizeof(V), checkpoints.size(), events.size()};
+        os.write(reinterpret_cast<const char*>(header), sizeof(header));
+        for (const Checkpoint& checkpoint : checkpoints) {
+            uint64_t info[2] = {checkpoint.sequence, checkpoint.data.size()};
+            os.write(reinterpret_cast<const char*>(info), sizeof(info));
+            os.write(checkpoint.data.data(), checkpoint.data.size());
+        }
+        os.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(EventType));
+        if (!os)
+            throw std::runtime_error("Could not write " + path + ".");
+    }
+
+    // "BSTTRACE" em little endian
+    static constexpr uint64_t file_magic = 0x4543415254545342ULL;
+
+ private:
+    struct Slot {
+        std::atomic<uint64_t> state{0};
+        EventType event;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask;
+    // Separa o contador disputado pelos produtores dos outros campos
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<bool> active{false};
+    uint64_t interval;
+    size_t max_checkpoints;
+    mutable std::mutex checkpoint_mutex;
+    std::vector<Checkpoint> stored;
+};
+
+/**
+ * Reconstrói estados de uma árvore a partir de checkpoints e eventos: parte
+ * do checkpoint mais recente anterior ao estado pedido e reaplica os eventos
+ * seguintes, incluindo rotações.
+ *
+ * @tparam Tree Tipo da árvore, como BST<int, int>.
+ */
+template<class Tree>
+class Replayer {
+ public:
+    using K = typename Tree::key_type;
+    using V = typename Tree::mapped_type;
+    using EventType = Event<K, V>;
+
+    Replayer(std::vector<Checkpoint> checkpoints, std::vector<EventType> events)
+        : checkpoints(std::move(checkpoints)), events(std::move(events)) {
+        std::sort(this->checkpoints.begin(), this->checkpoints.end(),
+            [](const Checkpoint& a, const Checkpoint& b) { return a.sequence < b.sequence; });
+    }
+
+    explicit Replayer(const Recorder<K, V>& recorder)
+        : Replayer(recorder.checkpoints(), recorder.events()) {}
+
+    static Replayer load(const std::string& path) {
+        std::ifstream is(path, std::ios::binary);
+        uint64_t header[5];
+        if (!is.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+            header[0] != Recorder<K, V>::file_magic)
+            throw std::runtime_error("Not a tree trace: " + path + ".");
+        if (header[1] != sizeof(K) || header[2] != sizeof(V))
+            throw std::runtime_error("Trace key or value type does not match.");
+        std::vector<Checkpoint> checkpoints(header[3]);
+        for (Checkpoint& checkpoint : checkpoints) {
+            uint64_t info[2];
+            is.read(reinterpret_cast<char*>(info), sizeof(info));
+            checkpoint.sequence = info[0];
+            checkpoint.data.resize(info[1]);
+            is.read(&checkpoint.data[0], info[1]);
+        }
+        std::vector<EventType> events(header[4]);
+        is.read(reinterpret_cast<char*>(events.data()), events.size() * sizeof(EventType));
+        if (!is)
+            throw std::runtime_error("Truncated trace " + path + ".");
+        return Replayer(std::move(checkpoints), std::move(events));
+    }
+
+    const std::vector<EventType>& get_events() const {
+        return this->events;
+    }
+
+    /// Primeiro estado que pode ser reconstruído.
+    uint64_t first() const {
+        for (const Checkpoint& checkpoint : this->checkpoints) {
+            if (this->reachable(checkpoint.sequence))
+                return checkpoint.sequence;
+        }
+        throw std::runtime_error("No usable checkpoint in trace.");
+    }
+
+    /// Estado após o último evento gravado.
+    uint64_t last() const {
+        return this->events.empty() ? this->first() : this->events.back().sequence + 1;
+    }
+
+    /// Reconstrói em tree, que deve estar vazia, o estado antes do evento sequence.
+    void state_at(uint64_t sequence, Tree& tree) const {
+        const Checkpoint* base = nullptr;
+        for (const Checkpoint& checkpoint : this->checkpoints) {
+            if (checkpoint.sequence <= sequence && this->reachable(checkpoint.sequence))
+                base = &checkpoint;
+        }
+        if (!base)
+            throw std::runtime_error("State " + std::to_string(sequence) + " is not recorded.");
+        tree.adopt(decode_tree<typename Tree::Node>(base->data));
+        auto event = std::lower_bound(this->events.begin(), this->events.end(), base->sequence,
+            [](const EventType& e, uint64_t s) { return e.sequence < s; });
+        for (; event != this->events.end() && event->sequence < sequence; ++event)
+            apply(tree, *event);
+    }
+
+    static void apply(Tree& tree, const EventType& event) {
+        switch (event.op) {
+            case Op::Insert:
+                tree.insert_or_assign(event.key, event.value);
+                break;
+            case Op::Erase:
+                tree.erase(event.key);
+                break;
+            case Op::RotateLeft:
+                tree.rotate_left(tree.find_node(event.key));
+                break;
+            case Op::RotateRight:
+                tree.rotate_right(tree.find_node(event.key));
+                break;
+            case Op::Rebalance:
+                tree.rebalance();
+                break;
+            case Op::Bulk:
+                // Os estados seguintes partem do checkpoint feito após a operação
+                throw std::runtime_error("Bulk operation can't be replayed.");
+        }
+    }
+
+ private:
+    std::vector<Checkpoint> checkpoints;
+    std::vector<EventType> events;
+
+    // Um checkpoint só serve se todos os eventos depois dele ainda existem
+    bool reachable(uint64_t sequence) const {
+        if (this->events.empty())
+            return true;
+        auto event = std::lower_bound(this->events.begin(), this->events.end(), sequence,
+            [](const EventType& e, uint64_t s) { return e.sequence < s; });
+        if (event == this->events.end())
+            return sequence == this->events.back().sequence + 1;
+        return event->sequence == sequence;
+    }
+};
+
+}  // namespace trace
+
+#endif  // TRACE_HPP_
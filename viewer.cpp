@@ -0,0 +1,61 @@
+#include "./BST.hpp"
+#include "./shm.hpp"
+#include "./vis.hpp"
+
+#include <chrono>
+#include <cstring>
+
+/*
+    Exibe a árvore publicada por um shm::Publisher de uma BST<int, int> em
+    outro processo, trocando-a a cada nova versão. A janela é redesenhada a
+    cada intervalo (1 segundo por padrão), e as subárvores abaixo da
+    profundidade 10 começam recolhidas. Com --print, as versões são apenas
+    impressas no terminal.
+        ./viewer /bst [intervalo] [--print]
+*/
+
+using Tree = BST<int, int>;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Uso: " << argv[0] << " /nome [intervalo] [--print]" << std::endl;
+        return 1;
+    }
+    bool print = false;
+    double interval = 1.0;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--print") == 0)
+            print = true;
+        else
+            interval = std::max(std::stod(argv[i]), 0.05);
+    }
+
+    shm::Subscriber subscriber(argv[1]);
+    std::unique_ptr<Visualization<Tree::Node*>> system;
+    Tree tree;
+    uint64_t version = 0;
+    while (true) {
+        Tree next;
+        if (uint64_t latest = subscriber.load(next, version)) {
+            version = latest;
+            tree = std::move(next);
+            std::cout << "Versão " << version << ", " << (tree.get_root() ? tree.get_root()->size : 0)
+                << " nós" << std::endl;
+            if (print)
+                tree.print();
+            else if (system)
+                system->set_root(tree.get_root());
+        }
+        if (print || !tree.get_root()) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(interval));
+            continue;
+        }
+        if (!system) {
+            system.reset(new Visualization<Tree::Node*>(tree.get_root(), false, 1280, 720));
+            system->set_collapse_depth(10);
+        }
+        if (!system->draw(interval, true))
+            break;
+    }
+    return 0;
+}
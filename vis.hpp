@@ -10,19 +10,25 @@
 #include <glm/ext/vector_float4.hpp>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/matrix_transform.hpp>
-#include <glm/trigonometric.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <array>
 #include <iostream>
+#include <memory>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <type_traits>
+#include <unordered_set>
 #include <vector>
 
-typedef unsigned int uint;
+#include "./capture.hpp"
+#include "./layout.hpp"
+#include "./profiler.hpp"
+#include "./stats.hpp"
 
-constexpr int number_of_circle_sides = 180;
+typedef unsigned int uint;
 
 
 
@@ -75,6 +81,17 @@ class Visualization {
         this->buffer = new char[1024];
         this->glyph_map = new Glyph[128];
         this->stride = false;
+        this->show_profile = false;
+        this->show_stats = false;
+        this->line_capacity = 0;
+        this->layout_algorithm = layout::Algorithm::Levels;
+        this->mouse_down = false;
+        this->visible_levels = 0;
+        for (int i = 0; i < 2; ++i) {
+            this->mark_VAO[i] = 0;
+            this->mark_VBO[i] = 0;
+            this->mark_count[i] = 0;
+        }
         for (int i = 0; i < 3; ++i) {
             this->shaders[i] = 0;
             this->VAO[i] = 0;
@@ -85,6 +102,8 @@ class Visualization {
 
     ~Visualization() {
         if (vis::window) {
+            this->profiler.disable();
+            this->frame_capture.stop();
             for (int i = 0; i < 3; ++i) {
                 if (this->shaders[i])
                     glDeleteProgram(this->shaders[i]);
@@ -97,6 +116,10 @@ class Visualization {
                 glDeleteVertexArrays(3, this->VAO);
             if (this->VBO[0])
                 glDeleteBuffers(3, this->VBO);
+            if (this->mark_VAO[0])
+                glDeleteVertexArrays(2, this->mark_VAO);
+            if (this->mark_VBO[0])
+                glDeleteBuffers(2, this->mark_VBO);
             if (glfwGetCurrentContext() == vis::window)
                 destroy_window();
             vis::window = nullptr;
@@ -113,6 +136,27 @@ class Visualization {
     /// Define o nó raiz da árvore.
     void set_root(NodePtr root) {
         this->root_node = root;
+        this->frontier.clear();
+    }
+
+    /**
+     * Recolhe as subárvores a partir da profundidade dada (a raiz tem
+     * profundidade 0), que são desenhadas como um único nó com o tamanho da
+     * subárvore. O layout só visita os nós visíveis, então o primeiro frame
+     * não depende do tamanho da árvore. No modo dinâmico, clicar em um nó o
+     * expande ou recolhe, e as teclas E e C descem ou sobem a profundidade.
+     * Um valor negativo expande a árvore inteira.
+     */
+    void set_collapse_depth(int depth) {
+        this->frontier.set_depth(depth);
+    }
+
+    /**
+     * Preenche os nós dados com outra cor, como os nós novos ou alterados de
+     * um diff (ver merkle::Diff::marked). Um vetor vazio remove o destaque.
+     */
+    void set_highlight(std::vector<NodePtr> nodes) {
+        this->highlighted = std::move(nodes);
     }
 
     /// Redefine o tamanho da janela.
@@ -156,6 +200,68 @@ class Visualization {
         }
     }
 
+    /**
+     * Ativa a medição do tempo de cada etapa da renderização. No modo dinâmico,
+     * a tecla P alterna a exibição da média recente de cada etapa abaixo do FPS.
+     *
+     * @param overlay Define se o detalhamento começa visível na tela.
+     * @param csv_path Se não for vazio, grava os tempos de cada frame neste arquivo.
+     */
+    void enable_profiling(bool overlay = true, const std::string& csv_path = "") {
+        this->profiler.enable(csv_path);
+        this->show_profile = overlay;
+    }
+
+    /// Desativa a medição e fecha o arquivo CSV, se houver.
+    void disable_profiling() {
+        this->profiler.disable();
+        this->show_profile = false;
+    }
+
+    /**
+     * Define se as estatísticas da árvore (ver stats.hpp) aparecem ao lado do
+     * FPS no modo dinâmico. A tecla H também alterna a exibição.
+     */
+    void enable_stats(bool overlay = true) {
+        this->show_stats = overlay;
+    }
+
+    const vis::FrameProfiler& get_profiler() const {
+        return this->profiler;
+    }
+
+    /**
+     * Grava cada frame desenhado, no tamanho atual da janela, sem esperar pela
+     * leitura da GPU (ver capture.hpp). target é um arquivo de frames RGBA crus
+     * ou, começando com '|', um comando que os recebe, como um encoder.
+     */
+    void enable_capture(const std::string& target) {
+        this->frame_capture.start(target, vis::width, vis::height);
+    }
+
+    void disable_capture() {
+        this->frame_capture.stop();
+    }
+
+    const vis::FrameCapture& get_capture() const {
+        return this->frame_capture;
+    }
+
+    /**
+     * Escolhe o algoritmo usado para posicionar os nós. O layout por contornos
+     * pode ser calculado em paralelo, o que compensa em árvores muito grandes.
+     *
+     * @param algorithm Algoritmo de layout.
+     * @param threads Threads usadas pelo layout por contornos; 1 executa na thread atual.
+     */
+    void set_layout(layout::Algorithm algorithm, uint threads = 1) {
+        this->layout_algorithm = algorithm;
+        if (algorithm == layout::Algorithm::Contour && threads > 1)
+            this->pool.reset(new par::WorkStealingPool(threads));
+        else
+            this->pool.reset();
+    }
+
     /// Aguarda pelo valor especificado em segundos.
     static void wait(double seconds) {
         double end_time = glfwGetTime() + seconds;
@@ -279,7 +385,25 @@ class Visualization {
     uint width;
     uint height;
     uint FPS;
+    // Quantidade de floats que cabem no buffer de linhas
+    uint line_capacity;
     bool stride;
+    bool show_profile;
+    bool show_stats;
+    vis::FrameProfiler profiler;
+    vis::FrameCapture frame_capture;
+    layout::Algorithm layout_algorithm;
+    std::unique_ptr<par::WorkStealingPool> pool;
+    std::vector<NodePtr> highlighted;
+    layout::Frontier<NodePtr> frontier;
+    // Evita que um clique mantido alterne o mesmo nó a cada frame
+    bool mouse_down;
+    int visible_levels;
+    // Centros dos nós destacados e dos recolhidos, desenhados por cima dos demais
+    uint mark_VAO[2];
+    uint mark_VBO[2];
+    uint mark_count[2];
+    using Stage = vis::FrameProfiler::Stage;
 
     enum Shape : uint {
         Line,
@@ -288,6 +412,11 @@ class Visualization {
         None
     };
 
+    enum Mark : uint {
+        Highlighted,
+        Collapsed
+    };
+
     static void destroy_window() {
         glfwDestroyWindow(vis::window);
         vis::window = nullptr;
@@ -357,24 +486,12 @@ class Visualization {
         glBindBuffer(GL_ARRAY_BUFFER, this->VBO[shape]);
     }
 
-    // Cria um círculo de raio 1.0 e centro (0, 0) com o número de lados
-    // especificado na constante acima, tudo isso em tempo de compilação.
-    float* create_circle() {
-        int index = 0;
-        constexpr int n = number_of_circle_sides;
-        float* circle = new float[n * 2];
-        for (float angle = 0; index < n * 2; angle += (glm::two_pi<float>() / n)) {
-            circle[index++] = glm::cos(angle);
-            circle[index++] = glm::sin(angle);
-        }
-        return circle;
-    }
-
     void create_line_data() {
         this->create_shader_program(Shape::Line);
         // Aloca espaço para 4096 floats, que equivale a 2048 vértices e 1024 linhas
         // que conectam os nós da árvore
-        glBufferData(GL_ARRAY_BUFFER, 4096 * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+        this->line_capacity = 4096;
+        glBufferData(GL_ARRAY_BUFFER, this->line_capacity * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
         int line_transform_location = glGetUniformLocation(this->shaders[Shape::Line], "transform");
@@ -388,13 +505,37 @@ class Visualization {
         this->use_program(Shape::None);
     }
 
+    // Cada nó é uma instância de um quadrado que cobre o círculo de raio 1.0 e
+    // centro (0, 0). O preenchimento, a borda e a suavização são calculados em
+    // node.fs pela distância ao centro, sem depender de multisampling.
     void create_node_data() {
         this->create_shader_program(Shape::Node);
-        float* circle = this->create_circle();
-        glBufferData(GL_ARRAY_BUFFER, number_of_circle_sides * 2 * sizeof(float), circle, GL_STATIC_DRAW);
+        const float corners[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
-        delete[] circle;
+        // Os centros vêm do buffer das linhas, em que cada nó ocupa 4 floats: a
+        // posição do pai seguida da sua. Assim, nada é enviado só para os nós.
+        glBindBuffer(GL_ARRAY_BUFFER, this->VBO[Shape::Line]);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+        glVertexAttribDivisor(1, 1);
+        glUniform4f(glGetUniformLocation(this->shaders[Shape::Node], "rgba"), 1.0f, 1.0f, 1.0f, 1.0f);
+        glUniform4f(glGetUniformLocation(this->shaders[Shape::Node], "border"), 0.0f, 0.0f, 0.0f, 1.0f);
+        // Os nós destacados e os recolhidos usam os mesmos cantos, com centros
+        // em buffers próprios
+        glGenVertexArrays(2, this->mark_VAO);
+        glGenBuffers(2, this->mark_VBO);
+        for (int i = 0; i < 2; ++i) {
+            glBindVertexArray(this->mark_VAO[i]);
+            glBindBuffer(GL_ARRAY_BUFFER, this->VBO[Shape::Node]);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+            glBindBuffer(GL_ARRAY_BUFFER, this->mark_VBO[i]);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), 0);
+            glVertexAttribDivisor(1, 1);
+        }
         this->use_program(Shape::None);
     }
 
@@ -424,8 +565,8 @@ class Visualization {
         if (!glfwInit())
             throw std::runtime_error("Falha ao inicializar GLFW.");
         try {
-            // Ativa antisserrilhamento mais pesado (multisampling)
-            glfwWindowHint(GLFW_SAMPLES, 4);
+            // Os nós são suavizados no shader, então o multisampling fica desligado
+            glfwWindowHint(GLFW_SAMPLES, 0);
 
             // Cria uma janela e seu contexto OpenGL
             if (fullscreen) {
@@ -472,162 +613,122 @@ class Visualization {
         }
     }
 
-    // Estrutura usada para armazenar o ponteiro a um nó e sua posição na tela
-    struct NodePos {
-        NodePtr node;
-        // Posição do nó relativa ao centro do tela
-        short position;
-        // Índice do nó pai no vetor de nós
-        short parent;
-        // Índice do nó filho esquerdo no vetor de nós
-        short left_index = 0;
-        // Índice do nó filho direito no vetor de nós
-        short right_index = 0;
-    };
+    using NodePos = layout::NodePos<NodePtr>;
 
-    // Encontra todos os nós de cada nível (altura) diferente da árvore e o
-    // o primeiro índice de cada nível da árvore. Armazena ponteiros para esses
-    // nós nos vetores dados como argumentos e retorna a maior distância entre
-    // qualquer nó e a origem, para evitar que seu tamanho exceda o máximo que
-    // a tela pode comportar. Também calcula as posições dos nós na exibição.
     int breadth_first_search(std::vector<NodePos>& nodes, std::vector<int>& beginnings) {
-        nodes.push_back(NodePos{this->root_node, 0, 0});
-        beginnings.push_back(0);
-        int index = 0, previous_queue_size = 0, max_distance_from_origin = 0;
-        while (index < nodes.size()) {
-            // Encontra índice inicial de cada nível (altura) da árvore
-            if (index == previous_queue_size) {
-                previous_queue_size = nodes.size();
-                beginnings.push_back(previous_queue_size);
-            }
-            if (nodes[index].node->left()) {
-                nodes[index].left_index = nodes.size();
-                nodes.push_back(NodePos{nodes[index].node->left(), static_cast<short>(
-                    nodes[index].position - 1), static_cast<short>(index)});
-
-                // Se o último nó adicionado colide com o penúltimo, move alguns nós
-                if (nodes[nodes.size() - 2].position == nodes.back().position) {
-                    bool should_move = false;
-                    // Avança o último nó para a direita
-                    ++nodes.back().position;
-                    // Recua todos os outros nós do mesmo nível para a esquerda
-                    for (int i = nodes.size() - 2; i >= beginnings.back(); --i)
-                        --nodes[i].position;
-                    
-                    int current_level = beginnings.size() - 1;
-                    int child = nodes.size() - 1;
-                    int parent = nodes[child].parent;
-                    // Se o pai tem o nó atual como filho esquerdo, atualiza sua posição e dos antecessores
-                    do {
-                        // Não move a raiz, assim ela sempre fica no centro da tela
-                        if (parent == 0)
-                            break;
-                        should_move = false;
-                        // Avança o pai do nó atual e todos à sua direita
-                        for (int i = parent; i < beginnings[current_level]; ++i) {
-                            ++nodes[i].position;
-                            // Se nós foram movidos neste nível, garante que o nível acima sofrerá
-                            // mudanças mesmo que o pai do nó atual tenha ele como filho direito
-                            should_move = true;
-                        }
-                        child = parent;
-                        parent = nodes[child].parent;
-                        --current_level;
-                    } while (shaders);
-
-                    current_level = beginnings.size() - 2;
-                    child = nodes.size() - 2;
-                    parent = nodes[child].parent;
-                    // Se o pai tem o nó deslocado para a esquerda como filho direito, atualiza posições
-                    do {
-                        if (parent == 0)
-                            break;
-                        should_move = false;
-                        // Recua todos os nós à esquerda do pai do nó afetado
-                        for (int i = parent; i >= beginnings[current_level]; --i) {
-                            --nodes[i].position;
-                            should_move = true;
-                        }
-                        child = parent;
-                        parent = nodes[child].parent;
-                        --current_level;
-                    } while (should_move);
-                }
+        int max_distance_from_origin;
+        if (this->layout_algorithm == layout::Algorithm::Contour)
+            max_distance_from_origin = layout::contour_layout(this->root_node, nodes, beginnings,
+                this->pool.get(), 0, &this->frontier);
+        else
+            max_distance_from_origin = layout::breadth_first_search(this->root_node, nodes, beginnings,
+                &this->frontier);
+        this->visible_levels = beginnings.size();
+        return max_distance_from_origin;
+    }
+
+    float* organize_data(const float radius_x, const float radius_y,
+        const std::vector<NodePos>& nodes, const std::vector<int>& beginnings) {
+        return layout::organize_data(radius_x, radius_y, nodes, beginnings, this->pool.get());
+    }
+
+    // Envia os vértices das linhas para a GPU, aumentando o buffer se a árvore
+    // não couber nele. Espera que o programa de linhas esteja em uso.
+    void upload_lines(const float* vertices, uint length) {
+        auto scope = this->profiler.scope(Stage::Upload);
+        if (length > this->line_capacity) {
+            while (this->line_capacity < length)
+                this->line_capacity *= 2;
+            glBufferData(GL_ARRAY_BUFFER, this->line_capacity * sizeof(float), vertices, GL_DYNAMIC_DRAW);
+        } else {
+            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * length, vertices);
+        }
+    }
+
+    // Envia os centros dos nós destacados e dos recolhidos que estão no layout atual
+    void upload_marks(const float* vertices, const std::vector<NodePos>& nodes) {
+        std::vector<float> centers[2];
+        auto add = [&](Mark mark, size_t j) {
+            centers[mark].push_back(vertices[4 * j + 2]);
+            centers[mark].push_back(vertices[4 * j + 3]);
+        };
+        for (size_t j = 0; j < nodes.size(); ++j) {
+            if (nodes[j].collapsed)
+                add(Mark::Collapsed, j);
+        }
+        if constexpr (layout::is_hashable<NodePtr>::value) {
+            std::unordered_set<NodePtr> marked(this->highlighted.begin(), this->highlighted.end());
+            for (size_t j = 0; !marked.empty() && j < nodes.size(); ++j) {
+                if (marked.count(nodes[j].node))
+                    add(Mark::Highlighted, j);
             }
-            // Inserções à direita nunca dão problema, pois são feitas da esqueda para a direita
-            if (nodes[index].node->right()) {
-                nodes[index].right_index = nodes.size();
-                nodes.push_back(NodePos{nodes[index].node->right(), static_cast<short>(
-                    nodes[index].position + 1), static_cast<short>(index)});
+        } else {
+            // Referências como CompactBST::NodeRef só têm ==
+            for (size_t j = 0; !this->highlighted.empty() && j < nodes.size(); ++j) {
+                if (std::find(this->highlighted.begin(), this->highlighted.end(), nodes[j].node) !=
+                    this->highlighted.end())
+                    add(Mark::Highlighted, j);
             }
-            ++index;
         }
-        // Se o último nível está completo, um índice inexistente é adicionado,
-        // então ele é removido aqui
-        if (beginnings.back() == index)
-            beginnings.pop_back();
-
-        int distance;
-        // Para cada nível, verifica a distância máxima entre um nó nas extremidades e a origem
-        for (uint i = 1; i < beginnings.size(); ++i) {
-            distance = std::max(
-                std::abs(nodes[beginnings[i]].position),
-                std::abs(nodes[beginnings[i] - 1].position)
-            );
-            if (distance > max_distance_from_origin)
-                max_distance_from_origin = distance;
+        for (int i = 0; i < 2; ++i) {
+            this->mark_count[i] = centers[i].size() / 2;
+            glBindBuffer(GL_ARRAY_BUFFER, this->mark_VBO[i]);
+            glBufferData(GL_ARRAY_BUFFER, centers[i].size() * sizeof(float), centers[i].data(),
+                GL_DYNAMIC_DRAW);
         }
-        distance = std::abs(nodes.back().position);
-        if (distance > max_distance_from_origin)
-            max_distance_from_origin = distance;
+        glBindBuffer(GL_ARRAY_BUFFER, this->VBO[Shape::Line]);
+    }
 
-        return max_distance_from_origin;
+    // Redesenha os nós destacados e os recolhidos com outros preenchimentos.
+    // Espera que o programa de nós esteja em uso.
+    void draw_marks() {
+        const float colors[2][3] = {{1.0f, 0.8f, 0.3f}, {0.7f, 0.85f, 1.0f}};
+        int rgba = glGetUniformLocation(this->shaders[Shape::Node], "rgba");
+        for (int i = 0; i < 2; ++i) {
+            if (!this->mark_count[i])
+                continue;
+            glUniform4f(rgba, colors[i][0], colors[i][1], colors[i][2], 1.0f);
+            glBindVertexArray(this->mark_VAO[i]);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, this->mark_count[i]);
+            glBindVertexArray(this->VAO[Shape::Node]);
+            glUniform4f(rgba, 1.0f, 1.0f, 1.0f, 1.0f);
+        }
     }
 
-    float* organize_data(const float radius_x, const float radius_y,
-        const std::vector<NodePos>& nodes, const std::vector<int>& beginnings) {
-        const float line_height = 4.0f * radius_y;
-        // Disposição dos dados: 2 floats para a posição inicial da linha, que é
-        // o nó pai, e 2 floats para a posição final, que é seu filho.
-        float* vertices = new float[nodes.size() * 4];
-        int current_level = 1;
-        // Altura do nível acima
-        float upper_height;
-        // Altura do nível atual
-        float height = 0.99f - radius_y;
-        
-        int j = 0;
-        // Os primeiros 4 floats ligam a raiz a si mesma
-        // X do pai
-        vertices[j++] = 0.0f;
-        // Y do pai
-        vertices[j++] = height;
-        // X do filho
-        vertices[j++] = 0.0f;
-        // Y do filho
-        vertices[j++] = height;
-
-        // i: índice do nó atual, que está sendo conectado ao seu pai
-        // j: índice do vetor de dados que está sendo preenchido
-        for (int i = 1; i < nodes.size(); ++i) {
-            if (current_level < beginnings.size() && i == beginnings[current_level]) {
-                upper_height = height;
-                height -= line_height;
-                ++current_level;
-            }
-            vertices[j++] = radius_x * (2 * nodes[nodes[i].parent].position);
-            vertices[j++] = upper_height;
-            vertices[j++] = radius_x * (2 * nodes[i].position);
-            vertices[j++] = height;
+    // Alterna entre recolhido e expandido o nó sob o cursor e retorna se
+    // algum nó mudou
+    bool toggle_at_cursor(const float* screen, const float* vertices, const std::vector<NodePos>& nodes,
+                          float radius_x, float radius_y) {
+        double cursor_x, cursor_y;
+        int window_width, window_height;
+        glfwGetCursorPos(vis::window, &cursor_x, &cursor_y);
+        glfwGetWindowSize(vis::window, &window_width, &window_height);
+        if (window_width <= 0 || window_height <= 0)
+            return false;
+        // Desfaz a projeção de glm::ortho; o cursor é medido a partir do canto superior esquerdo
+        float x = screen[0] + cursor_x / window_width * (screen[1] - screen[0]);
+        float y = screen[3] - cursor_y / window_height * (screen[3] - screen[2]);
+        for (size_t j = 0; j < nodes.size(); ++j) {
+            float dx = (x - vertices[4 * j + 2]) / radius_x;
+            float dy = (y - vertices[4 * j + 3]) / radius_y;
+            if (dx * dx + dy * dy > 1.0f)
+                continue;
+            NodePtr node = nodes[j].node;
+            if (!node->left() && !node->right())
+                return false;
+            this->frontier.toggle(node);
+            return true;
         }
-        return vertices;
+        return false;
     }
 
     void draw_tree_static(double wait_time) {
         // glActiveTexture(GL_TEXTURE0);
         std::vector<NodePos> nodes;
         std::vector<int> beginnings;
+        this->profiler.begin(Stage::Search);
         int max_distance_from_origin = this->breadth_first_search(nodes, beginnings);
+        this->profiler.end(Stage::Search);
 
         const float max_radius = 0.1f;
         const float ratio = static_cast<float>(vis::width) / vis::height;
@@ -652,23 +753,23 @@ class Visualization {
             radius_x = radius_y * inv_ratio;
 
         // Organiza os dados para serem enviados ao shader
+        this->profiler.begin(Stage::Organize);
         float* vertices = organize_data(radius_x, radius_y, nodes, beginnings);
+        this->profiler.end(Stage::Organize);
         int length = nodes.size() * 4;
 
         this->use_program(Shape::Line);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * length, vertices);
+        this->upload_lines(vertices, length);
+        this->upload_marks(vertices, nodes);
 
         // Desenha os nós por cima das linhas, ocultando a parte que ficaria interna
         this->use_program(Shape::Node);
-        int transform_location = glGetUniformLocation(this->shaders[Shape::Node], "transform");
-        int color_location = glGetUniformLocation(this->shaders[Shape::Node], "rgba");
+        glm::mat4 identity(1.0f);
+        glUniformMatrix4fv(glGetUniformLocation(this->shaders[Shape::Node], "transform"), 1, GL_FALSE,
+            glm::value_ptr(identity));
+        glUniform2f(glGetUniformLocation(this->shaders[Shape::Node], "radius"), radius_x, radius_y);
 
         // Variáveis que devem ser inicializadas fora da parte do código que pode ser repetida:
-        // Inicializa uma matriz básica de mudança de escala
-        float transform[4][4] = {
-            {radius_x, 0, 0, 0}, {0, radius_y, 0, 0},
-            {0, 0, 1, 0}, {0, 0, 0, 1}
-        };
         int j;
         // Altura da fonte: 0.05 * maior dimensão da tela em pixels
         // Assim, a escala é 1, que representa metade das coordenadas de -1 a 1
@@ -686,30 +787,32 @@ class Visualization {
 
         // Desenha as linhas conectando os nós
         this->use_program(Shape::Line);
-        glDrawArrays(GL_LINES, 0, length);
+        this->profiler.begin(Stage::Lines);
+        glDrawArrays(GL_LINES, 0, length / 2);
+        this->profiler.end(Stage::Lines);
 
         this->use_program(Shape::Node);
-        // Desenha os nós
-        for (int i = 2; i < length; i += 4) {
-            // Atualiza a parte de translação da matriz de transformação
-            transform[3][0] = vertices[i];
-            transform[3][1] = vertices[i + 1];
-            glUniformMatrix4fv(transform_location, 1, GL_FALSE, &transform[0][0]);
-            // Desenha o fundo branco do nó
-            glUniform4f(color_location, 1.0f, 1.0f, 1.0f, 1.0f);
-            glDrawArrays(GL_TRIANGLE_FAN, 0, number_of_circle_sides);
-            // Desenha a borda preta do nó
-            glUniform4f(color_location, 0.0f, 0.0f, 0.0f, 1.0f);
-            glDrawArrays(GL_LINE_LOOP, 0, number_of_circle_sides);
-        }
+        this->profiler.begin(Stage::Nodes);
+        // Desenha todos os nós, com fundo branco e borda preta, em uma única chamada
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, length / 4);
+        this->draw_marks();
+        this->profiler.end(Stage::Nodes);
 
         this->use_program(Shape::Text);
+        this->profiler.begin(Stage::Text);
         j = 0;
         for (int i = 2; i < length; i += 4) {
-            this->draw_text_from(nodes[j++].node, vertices[i], vertices[i + 1], scale_x, scale_y);
+            this->draw_label(nodes[j++], vertices[i], vertices[i + 1], scale_x, scale_y);
         }
+        this->profiler.end(Stage::Text);
 
+        this->profiler.begin(Stage::Capture);
+        this->frame_capture.capture();
+        this->profiler.end(Stage::Capture);
+        this->profiler.begin(Stage::Swap);
         glfwSwapBuffers(vis::window);
+        this->profiler.end(Stage::Swap);
+        this->profiler.end_frame();
         glfwPollEvents();
 
         action = UserAction::Idle;
@@ -734,6 +837,8 @@ class Visualization {
         Move,
         Wait,
         Redraw,
+        Relayout,
+        Click,
     };
 
     UserAction process_input() {
@@ -750,6 +855,10 @@ class Visualization {
             destroy_window();
             return UserAction::Skip;
         }
+        if (glfwGetKey(vis::window, GLFW_KEY_H) == GLFW_PRESS) {
+            this->show_stats = !this->show_stats;
+            return UserAction::Redraw;
+        }
         if (glfwGetKey(vis::window, GLFW_KEY_F11) == GLFW_PRESS ||
         glfwGetKey(vis::window, GLFW_KEY_F) == GLFW_PRESS) {
             toggle_fullscreen();
@@ -765,6 +874,13 @@ class Visualization {
             vis::resized = false;
             return UserAction::Redraw;
         }
+        // Só o momento em que o botão é pressionado conta como clique
+        bool clicked = glfwGetMouseButton(vis::window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+        if (clicked != this->mouse_down) {
+            this->mouse_down = clicked;
+            if (clicked)
+                return UserAction::Click;
+        }
         bool pressed = false;
         float increment = this->stride ? step * 15 : step;
         if (glfwGetKey(vis::window, GLFW_KEY_UP) == GLFW_PRESS || 
@@ -802,11 +918,28 @@ class Visualization {
             this->stride = !this->stride;
             return UserAction::Wait;
         }
+        if (glfwGetKey(vis::window, GLFW_KEY_P) == GLFW_PRESS && this->profiler.is_enabled()) {
+            this->show_profile = !this->show_profile;
+            return UserAction::Redraw;
+        }
         if (glfwGetKey(vis::window, GLFW_KEY_F11) == GLFW_PRESS ||
         glfwGetKey(vis::window, GLFW_KEY_F) == GLFW_PRESS) {
             toggle_fullscreen();
             return UserAction::Redraw;
         }
+        // Só desce enquanto houver nós recolhidos na profundidade atual
+        int depth = this->frontier.get_depth();
+        if (glfwGetKey(vis::window, GLFW_KEY_E) == GLFW_PRESS && depth >= 0 && depth < this->visible_levels) {
+            this->frontier.set_depth(depth + 1);
+            return UserAction::Relayout;
+        }
+        if (glfwGetKey(vis::window, GLFW_KEY_C) == GLFW_PRESS) {
+            // Sem profundidade definida, esconde o último nível visível
+            if (depth < 0)
+                depth = this->visible_levels - 1;
+            this->frontier.set_depth(std::max(depth - 1, 0));
+            return UserAction::Relayout;
+        }
         if (glfwGetKey(vis::window, GLFW_KEY_KP_ADD) == GLFW_PRESS) {
             for (int i = 0; i < 4; ++i)
                 screen[i] /= 1.1f;
@@ -834,8 +967,6 @@ class Visualization {
         // glActiveTexture(GL_TEXTURE0);
         std::vector<NodePos> nodes;
         std::vector<int> beginnings;
-        int max_distance_from_origin = this->breadth_first_search(nodes, beginnings);
-
         const float inv_ratio = static_cast<float>(vis::height) / vis::width;
         const float radius_y = 0.1f;
         const float radius_x = radius_y * inv_ratio;
@@ -843,19 +974,33 @@ class Visualization {
         const float scale_x = (1.0f / (std::max(vis::width, vis::height)) * radius_x);
         const float scale_y = (1.0f / (std::max(vis::width, vis::height)) * radius_y);
 
-        float* vertices = organize_data(radius_x, radius_y, nodes, beginnings);
-        int length = nodes.size() * 4;
+        float* vertices = nullptr;
+        int length = 0;
+        // Calcula o layout dos nós visíveis, de novo a cada nó expandido ou recolhido
+        auto relayout = [&] {
+            nodes.clear();
+            beginnings.clear();
+            delete[] vertices;
+            this->profiler.begin(Stage::Search);
+            this->breadth_first_search(nodes, beginnings);
+            this->profiler.end(Stage::Search);
+            this->profiler.begin(Stage::Organize);
+            vertices = organize_data(radius_x, radius_y, nodes, beginnings);
+            this->profiler.end(Stage::Organize);
+            length = nodes.size() * 4;
+            this->use_program(Shape::Line);
+            this->upload_lines(vertices, length);
+            this->upload_marks(vertices, nodes);
+        };
+        relayout();
 
         glm::mat4 basic_transform(1.0f);
-        glm::mat4 transform(1.0f);
         float screen[4] = {-1.0f, 1.0f, -1.0f, 1.0f};
 
-        this->use_program(Shape::Line);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * length, vertices);
         int line_transform_location = glGetUniformLocation(this->shaders[Shape::Line], "transform");
         this->use_program(Shape::Node);
         int node_transform_location = glGetUniformLocation(this->shaders[Shape::Node], "transform");
-        int node_color_location = glGetUniformLocation(this->shaders[Shape::Node], "rgba");
+        glUniform2f(glGetUniformLocation(this->shaders[Shape::Node], "radius"), radius_x, radius_y);
         this->use_program(Shape::Text);
         int text_transform_location = glGetUniformLocation(this->shaders[Shape::Text], "transform");
 
@@ -865,6 +1010,8 @@ class Visualization {
         double now;
         uint frames = 0;
         std::string fps;
+        // Calculadas na primeira vez em que são exibidas, pois a árvore não muda durante draw
+        std::string summary;
         UserAction action = UserAction::Idle;
         goto render;
         while (glfwGetTime() < end_time && !glfwWindowShouldClose(vis::window)) {
@@ -877,30 +1024,29 @@ class Visualization {
                 glClear(GL_COLOR_BUFFER_BIT);
 
                 this->use_program(Shape::Line);
+                this->profiler.begin(Stage::Lines);
                 glUniformMatrix4fv(line_transform_location, 1, GL_FALSE,
                     glm::value_ptr(basic_transform));
-                glDrawArrays(GL_LINES, 0, length);
+                glDrawArrays(GL_LINES, 0, length / 2);
+                this->profiler.end(Stage::Lines);
 
                 this->use_program(Shape::Node);
-                for (int i = 2; i < length; i += 4) {
-                    transform = glm::translate(basic_transform,
-                        glm::vec3(vertices[i], vertices[i + 1], 0.0f));
-                    transform = glm::scale(transform, glm::vec3(radius_x, radius_y, 1.0f));
-
-                    glUniformMatrix4fv(node_transform_location, 1, GL_FALSE, glm::value_ptr(transform));
-                    glUniform4f(node_color_location, 1.0f, 1.0f, 1.0f, 1.0f);
-                    glDrawArrays(GL_TRIANGLE_FAN, 0, number_of_circle_sides);
-                    glUniform4f(node_color_location, 0.0f, 0.0f, 0.0f, 1.0f);
-                    glDrawArrays(GL_LINE_LOOP, 0, number_of_circle_sides);
-                }
+                this->profiler.begin(Stage::Nodes);
+                glUniformMatrix4fv(node_transform_location, 1, GL_FALSE,
+                    glm::value_ptr(basic_transform));
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, length / 4);
+                this->draw_marks();
+                this->profiler.end(Stage::Nodes);
 
                 this->use_program(Shape::Text);
+                this->profiler.begin(Stage::Text);
                 glUniformMatrix4fv(text_transform_location, 1, GL_FALSE,
                     glm::value_ptr(basic_transform));
                 int j = 0;
                 for (int i = 2; i < length; i += 4) {
-                    this->draw_text_from(nodes[j++].node, vertices[i], vertices[i + 1], scale_x, scale_y);
+                    this->draw_label(nodes[j++], vertices[i], vertices[i + 1], scale_x, scale_y);
                 }
+                this->profiler.end(Stage::Text);
 
                 ++frames;
                 // Computa o FPS a cada 0.5 segundos
@@ -916,14 +1062,36 @@ class Visualization {
 
                 // Desenha o FPS na tela
                 this->draw_text_from(fps, -0.99f, 0.0f, scale_x / 2, scale_y / 2, false, true);
+                if (this->show_stats) {
+                    if (summary.empty())
+                        summary = stats::collect(this->root_node).to_string();
+                    this->draw_stats_overlay(summary, scale_x, scale_y);
+                }
+                if (this->show_profile && this->profiler.is_enabled())
+                    this->draw_profile_overlay(scale_x, scale_y);
 
                 this->use_program(Shape::None);
+                this->profiler.begin(Stage::Capture);
+                this->frame_capture.capture();
+                this->profiler.end(Stage::Capture);
+                this->profiler.begin(Stage::Swap);
                 glfwSwapBuffers(vis::window);
+                this->profiler.end(Stage::Swap);
+                this->profiler.end_frame();
 
                 if (this->stride) {
                     wait(0.5);
                     glfwPollEvents();
                 }
+            // Um nó expandido ou recolhido muda só o layout dos nós visíveis
+            } else if (action == UserAction::Click || action == UserAction::Relayout) {
+                if (action == UserAction::Click &&
+                    !this->toggle_at_cursor(screen, vertices, nodes, radius_x, radius_y))
+                    continue;
+                relayout();
+                if (action == UserAction::Relayout)
+                    wait(0.1);
+                goto render;
             // Se a ação é ativar o stride ou redesenhar a tela, como em caso de
             // redimensionamento, espera por 0.1 segundo
             } else if (action >= UserAction::Wait) {
@@ -940,6 +1108,29 @@ class Visualization {
         delete[] vertices;
     }
 
+    // Desenha a média recente de cada etapa abaixo do FPS, com os tempos de CPU
+    // e GPU em milissegundos. Espera que o programa de texto esteja em uso.
+    void draw_profile_overlay(float scale_x, float scale_y) {
+        auto scope = this->profiler.scope(Stage::Overlay);
+        // Mesmo fator usado para o FPS, que tem no máximo 3 caracteres
+        const float factor = 64.0f / 3 / 2;
+        const float line_step = this->glyph_map['0'].height * scale_y * factor * 1.5f;
+        float y = 0.99f - 2 * line_step;
+        this->draw_text("stage      cpu     gpu", -0.99f, y, scale_x * factor, scale_y * factor);
+        for (const std::string& line : this->profiler.report()) {
+            y -= line_step;
+            this->draw_text(line, -0.99f, y, scale_x * factor, scale_y * factor);
+        }
+    }
+
+    // Desenha as estatísticas da árvore à direita do FPS, na mesma escala dele
+    void draw_stats_overlay(const std::string& summary, float scale_x, float scale_y) {
+        const float factor = 64.0f / 3 / 2;
+        const float advance = (this->glyph_map['0'].advance >> 6) * scale_x * factor;
+        const float y = 0.99f - this->glyph_map['0'].height * scale_y * factor;
+        this->draw_text(summary, -0.99f + 4 * advance, y, scale_x * factor, scale_y * factor);
+    }
+
     void draw_text(const std::string& key, float x, float y, float scale_x, float scale_y) {
         std::array<float, 24> vertices;
         for (char c : key) {
@@ -968,6 +1159,16 @@ class Visualization {
         }
     }
 
+    // Nós recolhidos mostram o tamanho da subárvore no lugar da chave
+    void draw_label(const NodePos& pos, float x, float y, float scale_x, float scale_y) {
+        if (!pos.collapsed) {
+            this->draw_text_from(pos.node, x, y, scale_x, scale_y);
+            return;
+        }
+        size_t size = layout::known_size(pos.node, 0);
+        this->draw_text_from(size ? "+" + std::to_string(size) : std::string("+"), x, y, scale_x, scale_y);
+    }
+
     void draw_text_from(const NodePtr node, float x, float y, float scale_x, float scale_y) {
         std::stringstream ss;
         ss << node->key();